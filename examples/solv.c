@@ -57,6 +57,7 @@
 #include "solverdebug.h"
 #include "chksum.h"
 #include "repo_solv.h"
+#include "whatprovidescache.h"
 
 #include "repo_write.h"
 #ifndef DEBIAN
@@ -1466,6 +1467,86 @@ load_stub(Pool *pool, Repodata *data, void *dp)
 
 static unsigned char installedcookie[32];
 
+/* whatprovides cache helpers */
+
+#define WHATPROVIDESCACHE_PATH SOLVCACHE_PATH "/.whatprovides"
+
+/* combine the cookies of all repos. Returns 0 if a repo is not cached */
+int
+calcwhatprovidescookie(Pool *pool, unsigned char *cookie)
+{
+  void *h;
+  Repo *repo;
+  struct repoinfo *cinfo;
+  int i;
+
+  h = sat_chksum_create(REPOKEY_TYPE_SHA256);
+  FOR_REPOS(i, repo)
+    {
+      cinfo = repo->appdata;
+      if (repo == pool->installed)
+	sat_chksum_add(h, installedcookie, sizeof(installedcookie));
+      else if (cinfo)
+	sat_chksum_add(h, cinfo->cookie, sizeof(cinfo->cookie));
+      else
+	{
+	  sat_chksum_free(h, 0);
+	  return 0;
+	}
+    }
+  sat_chksum_free(h, cookie);
+  return 1;
+}
+
+int
+usecachedwhatprovides(Pool *pool, unsigned char *cookie)
+{
+  FILE *fp;
+  int r;
+
+  if (!(fp = fopen(WHATPROVIDESCACHE_PATH, "r")))
+    return 0;
+  r = pool_loadwhatprovides(pool, fp, cookie);
+  fclose(fp);
+  return r == 0;
+}
+
+void
+writecachedwhatprovides(Pool *pool, unsigned char *cookie)
+{
+  FILE *fp;
+  int fd;
+  char *tmpl;
+
+  mkdir(SOLVCACHE_PATH, 0755);
+  tmpl = sat_dupjoin(SOLVCACHE_PATH, "/", ".newwhatprovides-XXXXXX");
+  fd = mkstemp(tmpl);
+  if (fd < 0)
+    {
+      free(tmpl);
+      return;
+    }
+  fchmod(fd, 0444);
+  if (!(fp = fdopen(fd, "w")))
+    {
+      close(fd);
+      unlink(tmpl);
+      free(tmpl);
+      return;
+    }
+  if (pool_writewhatprovides(pool, fp, cookie))
+    {
+      fclose(fp);
+      unlink(tmpl);
+      free(tmpl);
+      return;
+    }
+  if (fclose(fp) || rename(tmpl, WHATPROVIDESCACHE_PATH))
+    unlink(tmpl);
+  free(tmpl);
+}
+
+
 #ifdef DEBIAN
 
 const char *
@@ -2550,6 +2631,7 @@ main(int argc, char **argv)
   FILE **newpkgsfps;
   Id *addedfileprovides = 0;
   Id repofilter = 0;
+  unsigned char whatprovidescookie[32];
 
   argc--;
   argv++;
@@ -2757,7 +2839,13 @@ main(int argc, char **argv)
   if (addedfileprovides && *addedfileprovides)
     rewrite_repos(pool, addedfileprovides);
   sat_free(addedfileprovides);
-  pool_createwhatprovides(pool);
+  if (!calcwhatprovidescookie(pool, whatprovidescookie))
+    pool_createwhatprovides(pool);
+  else if (!usecachedwhatprovides(pool, whatprovidescookie))
+    {
+      pool_createwhatprovides(pool);
+      writecachedwhatprovides(pool, whatprovidescookie);
+    }
 
   queue_init(&job);
   for (i = 1; i < argc; i++)
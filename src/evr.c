@@ -15,6 +15,8 @@
 #include <string.h>
 #include "evr.h"
 #include "pool.h"
+#include "bitmap.h"
+#include "util.h"
 
 
 
@@ -233,6 +235,21 @@ pool_evrcmp(const Pool *pool, Id evr1id, Id evr2id, int mode)
   const char *evr1, *evr2;
   if (evr1id == evr2id)
     return 0;
+  if (pool->evrranks && mode != EVRCMP_MATCH && !pool->promoteepoch
+      && (unsigned int)evr1id < (unsigned int)pool->nevrranks
+      && (unsigned int)evr2id < (unsigned int)pool->nevrranks)
+    {
+      const Id *r1 = pool->evrranks + 2 * evr1id;
+      const Id *r2 = pool->evrranks + 2 * evr2id;
+      /* MATCH_RELEASE compares the releases only if both have one */
+      if (mode == EVRCMP_COMPARE || (mode == EVRCMP_MATCH_RELEASE && (r1[1] & r2[1] & 1) != 0))
+	{
+	  if (r1[0] && r2[0])
+	    return r1[0] < r2[0] ? -1 : r1[0] > r2[0] ? 1 : 0;
+	}
+      else if ((r1[1] >> 1) && (r2[1] >> 1))
+	return (r1[1] >> 1) < (r2[1] >> 1) ? -1 : (r1[1] >> 1) > (r2[1] >> 1) ? 1 : 0;
+    }
   evr1 = id2str(pool, evr1id);
   evr2 = id2str(pool, evr2id);
   return evrcmp_str(pool, evr1, evr2, mode);
@@ -286,3 +303,179 @@ pool_evrmatch(const Pool *pool, Id evrid, const char *epoch, const char *version
   return 0;
 }
 
+
+/*
+ * evr ranks
+ *
+ * The evrs of all solvables and version relations are sorted once, so
+ * that pool_evrcmp() can compare them by comparing their position in
+ * the sorted list instead of parsing the strings. Two ranks are kept
+ * per evr: one for EVRCMP_COMPARE and one for the epoch:version part,
+ * which together also answer EVRCMP_MATCH_RELEASE and
+ * EVRCMP_COMPARE_EVONLY. EVRCMP_MATCH and evrs without a rank, e.g.
+ * ones used only in a job, still use the string compare.
+ *
+ * A rank is only correct if the evr compares the same way against all
+ * members of a group of equal evrs. An empty release ("1.0-") compares
+ * equal to any release of the same version, so such evrs do not get a
+ * rank for EVRCMP_COMPARE. Groups that turn out not to be consistent
+ * with their neighbours after sorting lose their rank, too.
+ */
+
+struct evrrankscmp_data {
+  const Pool *pool;
+  int mode;
+};
+
+static int
+evrranks_sort_cmp(const void *ap, const void *bp, void *dp)
+{
+  struct evrrankscmp_data *cd = dp;
+  const Pool *pool = cd->pool;
+  Id a = *(Id *)ap;
+  Id b = *(Id *)bp;
+  return pool_evrcmp_str(pool, id2str(pool, a), id2str(pool, b), cd->mode);
+}
+
+/* true if the release part of the evr is not empty */
+static inline int
+evr_hasrelease(const char *evr)
+{
+  const char *r = strrchr(evr, '-');
+  return r && r[1];
+}
+
+/* true if the evr has a '-' but nothing after it */
+static inline int
+evr_emptyrelease(const char *evr)
+{
+  const char *r = strrchr(evr, '-');
+  return r && !r[1];
+}
+
+/*
+ * sort the evrs and store their rank in ranks[2 * evr + slot]. Equal
+ * evrs get the same rank. A group of equal evrs gets rank 0 if one of
+ * its members differs from the first one or if the group does not
+ * sort after the previous group, i.e. if the compare is not
+ * transitive for them.
+ */
+static void
+evrranks_assign(Pool *pool, Id *evrs, int nevrs, int mode, Id *ranks, int slot)
+{
+  struct evrrankscmp_data cd;
+  const char *first, *prev;
+  int i, j, g, bad, pbad;
+  Id rank;
+
+  cd.pool = pool;
+  cd.mode = mode;
+  sat_sort(evrs, nevrs, sizeof(Id), evrranks_sort_cmp, &cd);
+  prev = 0;
+  pbad = 0;
+  for (g = 0, rank = 0; g < nevrs; g = i)
+    {
+      first = id2str(pool, evrs[g]);
+      bad = prev && pool_evrcmp_str(pool, prev, first, mode) >= 0;
+      for (i = g + 1; i < nevrs; i++)
+	if (pool_evrcmp_str(pool, id2str(pool, evrs[i - 1]), id2str(pool, evrs[i]), mode) != 0)
+	  break;
+	else if (pool_evrcmp_str(pool, first, id2str(pool, evrs[i]), mode) != 0)
+	  bad = 1;
+      rank++;
+      for (j = g; j < i; j++)
+	ranks[2 * evrs[j] + slot] = bad ? 0 : rank;
+      if (bad && !pbad && prev)
+	{
+	  /* the previous group is not safe either */
+	  for (j = g - 1; j >= 0 && ranks[2 * evrs[j] + slot] == rank - 1; j--)
+	    ranks[2 * evrs[j] + slot] = 0;
+	}
+      prev = first;
+      pbad = bad;
+    }
+}
+
+/*
+ * create the rank table or add the evrs that are not yet ranked.
+ * The table is not used if promoteepoch is set, as a missing epoch
+ * is then treated differently on both sides of the compare.
+ */
+void
+pool_createevrranks(Pool *pool)
+{
+  Id *evrs, *ranks, id;
+  int i, j, nevrs, stale;
+  Solvable *s;
+  Reldep *rd;
+  Map m;
+  unsigned int now;
+
+  POOL_CHECK_THAWED(pool);
+  if (pool->promoteepoch)
+    {
+      pool_freeevrranks(pool);
+      return;
+    }
+  now = sat_timems(0);
+  map_init(&m, pool->ss.nstrings);
+  nevrs = 0;
+  for (i = 2, s = pool->solvables + i; i < pool->nsolvables; i++, s++)
+    if (s->repo && s->evr && !MAPTST(&m, s->evr))
+      {
+	MAPSET(&m, s->evr);
+	nevrs++;
+      }
+  for (i = 1, rd = pool->rels + i; i < pool->nrels; i++, rd++)
+    if (rd->flags > 0 && rd->flags < 8 && rd->evr && !ISRELDEP(rd->evr) && !MAPTST(&m, rd->evr))
+      {
+	MAPSET(&m, rd->evr);
+	nevrs++;
+      }
+
+  /* nothing to do if all evrs already have a rank */
+  stale = 1;
+  if (pool->evrranks)
+    {
+      for (id = 1; id < pool->ss.nstrings; id++)
+	if (MAPTST(&m, id) && (id >= pool->nevrranks || !pool->evrranks[2 * id + 1]))
+	  break;
+      stale = id < pool->ss.nstrings;
+    }
+  if (!stale)
+    {
+      map_free(&m);
+      return;
+    }
+
+  evrs = sat_malloc2(nevrs ? nevrs : 1, sizeof(Id));
+  for (id = 1, i = 0; id < pool->ss.nstrings; id++)
+    if (MAPTST(&m, id))
+      evrs[i++] = id;
+  map_free(&m);
+  ranks = sat_calloc(2 * pool->ss.nstrings, sizeof(Id));
+
+  evrranks_assign(pool, evrs, nevrs, EVRCMP_COMPARE_EVONLY, ranks, 1);
+  for (i = 0; i < nevrs; i++)
+    ranks[2 * evrs[i] + 1] = ranks[2 * evrs[i] + 1] << 1 | evr_hasrelease(id2str(pool, evrs[i]));
+
+  /* evrs with an empty release are left out, see above */
+  for (i = j = 0; i < nevrs; i++)
+    if (!evr_emptyrelease(id2str(pool, evrs[i])))
+      evrs[j++] = evrs[i];
+  evrranks_assign(pool, evrs, j, EVRCMP_COMPARE, ranks, 0);
+  sat_free(evrs);
+
+  sat_free(pool->evrranks);
+  pool->evrranks = ranks;
+  pool->nevrranks = pool->ss.nstrings;
+  POOL_DEBUG(SAT_DEBUG_STATS, "evr ranks: %d evrs\n", nevrs);
+  POOL_DEBUG(SAT_DEBUG_STATS, "createevrranks took %d ms\n", sat_timems(now));
+}
+
+void
+pool_freeevrranks(Pool *pool)
+{
+  pool->evrranks = sat_free(pool->evrranks);
+  pool->nevrranks = 0;
+}
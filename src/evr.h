@@ -30,6 +30,11 @@ extern int pool_evrcmp_str(const Pool *pool, const char *evr1, const char *evr2,
 extern int pool_evrcmp(const Pool *pool, Id evr1id, Id evr2id, int mode);
 extern int pool_evrmatch(const Pool *pool, Id evrid, const char *epoch, const char *version, const char *release);
 
+/* rank table for pool_evrcmp(), kept up to date by
+ * pool_createwhatprovides() once created */
+extern void pool_createevrranks(Pool *pool);
+extern void pool_freeevrranks(Pool *pool);
+
 /* obsolete, do not use in new code */
 static inline int vercmp(const char *s1, const char *q1, const char *s2, const char *q2)
 {
@@ -102,17 +102,19 @@ prune_to_highest_prio(Pool *pool, Queue *plist)
       if (s->repo->priority == bestprio || (pool->installed && s->repo == pool->installed))
 	plist->elements[j++] = plist->elements[i];
     }
-  plist->count = j;
+  queue_truncate(plist, j);
 }
 
 static void
-prune_to_highest_prio_per_name(Pool *pool, Queue *plist)
+prune_to_highest_prio_per_name(Solver *solv, Queue *plist)
 {
+  Pool *pool = solv->pool;
   Queue pq;
   int i, j, k;
   Id name;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
-  queue_init(&pq);
+  scratch_queue_init(&solv->scratch, &pq, plist->count);
   sat_sort(plist->elements, plist->count, sizeof(Id), prune_to_best_version_sortcmp, pool);
   queue_push(&pq, plist->elements[0]);
   name = pool->solvables[pq.elements[0]].name;
@@ -134,7 +136,94 @@ prune_to_highest_prio_per_name(Pool *pool, Queue *plist)
   for (k = 0; k < pq.count; k++)
     plist->elements[j++] = pq.elements[k];
   queue_free(&pq);
-  plist->count = j;
+  scratch_release(&solv->scratch, scratchmark);
+  queue_truncate(plist, j);
+}
+
+
+/*
+ * recommendsmap/suggestsmap maintenance
+ *
+ * The maps contain the packages recommended/suggested by the
+ * installed packages of the decisionq up to recommends_index.
+ * Every package has a reference count, so that reverting a decision
+ * just takes away its part instead of rebuilding both maps.
+ */
+
+static inline void
+refrecommended(Map *m, Id *refs, Id p, int add)
+{
+  if (add)
+    {
+      if (refs[p]++ == 0)
+	MAPSET(m, p);
+    }
+  else if (--refs[p] == 0)
+    MAPCLR(m, p);
+}
+
+static void
+addrecommended(Solver *solv, Id p, int add)
+{
+  Pool *pool = solv->pool;
+  Solvable *s = pool->solvables + p;
+  Id pp, rec, *recp, sug, *sugp;
+
+  if (s->recommends)
+    {
+      recp = s->repo->idarraydata + s->recommends;
+      while ((rec = *recp++) != 0)
+	FOR_PROVIDES(p, pp, rec)
+	  refrecommended(&solv->recommendsmap, solv->recommendsrefs, p, add);
+    }
+  if (s->suggests)
+    {
+      sugp = s->repo->idarraydata + s->suggests;
+      while ((sug = *sugp++) != 0)
+	FOR_PROVIDES(p, pp, sug)
+	  refrecommended(&solv->suggestsmap, solv->suggestsrefs, p, add);
+    }
+}
+
+/* bring the maps up to the current decisionq */
+void
+policy_update_recommendsmap(Solver *solv)
+{
+  Pool *pool = solv->pool;
+  Id p;
+
+  if (solv->recommends_index < 0 || !solv->recommendsrefs)
+    {
+      if (!solv->recommendsrefs)
+	{
+	  solv->recommendsrefs = sat_calloc(pool->nsolvables, sizeof(Id));
+	  solv->suggestsrefs = sat_calloc(pool->nsolvables, sizeof(Id));
+	}
+      else
+	{
+	  memset(solv->recommendsrefs, 0, pool->nsolvables * sizeof(Id));
+	  memset(solv->suggestsrefs, 0, pool->nsolvables * sizeof(Id));
+	}
+      MAPZERO(&solv->recommendsmap);
+      MAPZERO(&solv->suggestsmap);
+      solv->recommends_index = 0;
+    }
+  while (solv->recommends_index < solv->decisionq.count)
+    {
+      p = solv->decisionq.elements[solv->recommends_index++];
+      if (p > 0)
+	addrecommended(solv, p, 1);
+    }
+}
+
+/* take back the last decision of the decisionq, called by
+ * the solver before it reverts the decision */
+void
+policy_revert_recommendsmap(Solver *solv)
+{
+  Id p = solv->decisionq.elements[--solv->recommends_index];
+  if (p > 0)
+    addrecommended(solv, p, 0);
 }
 
 
@@ -149,7 +238,7 @@ prune_to_recommended(Solver *solv, Queue *plist)
   Pool *pool = solv->pool;
   int i, j, k, ninst;
   Solvable *s;
-  Id p, pp, rec, *recp, sug, *sugp;
+  Id p;
 
   ninst = 0;
   if (pool->installed)
@@ -165,34 +254,7 @@ prune_to_recommended(Solver *solv, Queue *plist)
   if (plist->count - ninst < 2)
     return;
 
-  /* update our recommendsmap/suggestsmap */
-  if (solv->recommends_index < 0)
-    {
-      MAPZERO(&solv->recommendsmap);
-      MAPZERO(&solv->suggestsmap);
-      solv->recommends_index = 0;
-    }
-  while (solv->recommends_index < solv->decisionq.count)
-    {
-      p = solv->decisionq.elements[solv->recommends_index++];
-      if (p < 0)
-	continue;
-      s = pool->solvables + p;
-      if (s->recommends)
-	{
-	  recp = s->repo->idarraydata + s->recommends;
-          while ((rec = *recp++) != 0)
-	    FOR_PROVIDES(p, pp, rec)
-	      MAPSET(&solv->recommendsmap, p);
-	}
-      if (s->suggests)
-	{
-	  sugp = s->repo->idarraydata + s->suggests;
-          while ((sug = *sugp++) != 0)
-	    FOR_PROVIDES(p, pp, sug)
-	      MAPSET(&solv->suggestsmap, p);
-	}
-    }
+  policy_update_recommendsmap(solv);
 
   /* prune to recommended/supplemented */
   ninst = 0;
@@ -222,7 +284,7 @@ prune_to_recommended(Solver *solv, Queue *plist)
       plist->elements[j++] = p;
     }
   if (j)
-    plist->count = j;
+    queue_truncate(plist, j);
 
   /* anything left to prune? */
   if (plist->count - ninst < 2)
@@ -256,7 +318,7 @@ prune_to_recommended(Solver *solv, Queue *plist)
       plist->elements[j++] = p;
     }
   if (j)
-    plist->count = j;
+    queue_truncate(plist, j);
 }
 
 void
@@ -292,7 +354,7 @@ prune_to_best_arch(const Pool *pool, Queue *plist)
       plist->elements[j++] = plist->elements[i];
     }
   if (j)
-    plist->count = j;
+    queue_truncate(plist, j);
 }
 
 /*
@@ -341,7 +403,7 @@ prune_obsoleted(Pool *pool, Queue *plist)
   for (i = j = 0; i < plist->count; i++)
     if (plist->elements[i])
       plist->elements[j++] = plist->elements[i];
-  plist->count = j;
+  queue_truncate(plist, j);
 }
 
 /*
@@ -394,7 +456,7 @@ prune_to_best_version(Pool *pool, Queue *plist)
         }
     }
   plist->elements[j++] = best - pool->solvables;	/* finish last group */
-  plist->count = j;
+  queue_truncate(plist, j);
 
   /* we reduced the list to one package per name, now look at
    * package obsoletes */
@@ -447,7 +509,7 @@ prune_installed_dup_packages(Solver *solv, Queue *plist)
       plist->elements[j++] = p;
     }
   if (j)
-    plist->count = j;
+    queue_truncate(plist, j);
 }
 
 /*
@@ -464,7 +526,7 @@ policy_filter_unwanted(Solver *solv, Queue *plist, int mode)
       if (mode != POLICY_MODE_SUGGEST)
         prune_to_highest_prio(pool, plist);
       else
-        prune_to_highest_prio_per_name(pool, plist);
+        prune_to_highest_prio_per_name(solv, plist);
       /* installed dup packages need special treatment as prio pruning
        * does not prune installed packages */
       if (plist->count > 1 && pool->installed && (solv->dupmap_all || solv->dupinvolvedmap.size))
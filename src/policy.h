@@ -72,3 +72,6 @@ extern void policy_findupdatepackages(Solver *solv,
 
 extern void policy_create_obsolete_index(Solver *solv);
 
+extern void policy_update_recommendsmap(Solver *solv);
+extern void policy_revert_recommendsmap(Solver *solv);
+
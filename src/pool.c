@@ -17,6 +17,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 
 #include "pool.h"
 #include "repo.h"
@@ -84,7 +85,10 @@ pool_free(Pool *pool)
 {
   int i;
 
+  if (pool->frozen)
+    pool_thaw(pool);
   pool_freewhatprovides(pool);
+  pool_freeevrranks(pool);
   pool_freeidhashes(pool);
   repo_freeallrepos(pool, 1);
   sat_free(pool->id2arch);
@@ -107,12 +111,18 @@ void
 pool_setdisttype(Pool *pool, int disttype)
 {
   pool->disttype = disttype;
+  if (pool->evrranks)
+    {
+      pool_freeevrranks(pool);
+      pool_createevrranks(pool);
+    }
 }
 #endif
 
 Id
 pool_add_solvable(Pool *pool)
 {
+  POOL_CHECK_THAWED(pool);
   pool->solvables = sat_extend(pool->solvables, pool->nsolvables, 1, sizeof(Solvable), SOLVABLE_BLOCK);
   memset(pool->solvables + pool->nsolvables, 0, sizeof(Solvable));
   return pool->nsolvables++;
@@ -122,6 +132,7 @@ Id
 pool_add_solvable_block(Pool *pool, int count)
 {
   Id nsolvables = pool->nsolvables;
+  POOL_CHECK_THAWED(pool);
   if (!count)
     return nsolvables;
   pool->solvables = sat_extend(pool->solvables, pool->nsolvables, count, sizeof(Solvable), SOLVABLE_BLOCK);
@@ -133,6 +144,7 @@ pool_add_solvable_block(Pool *pool, int count)
 void
 pool_free_solvable_block(Pool *pool, Id start, int count, int reuseids)
 {
+  POOL_CHECK_THAWED(pool);
   if (!count)
     return;
   if (reuseids && start + count == pool->nsolvables)
@@ -150,8 +162,9 @@ pool_set_installed(Pool *pool, Repo *installed)
 {
   if (pool->installed == installed)
     return;
+  POOL_CHECK_THAWED(pool);
   pool->installed = installed;
-  pool_freewhatprovides(pool);
+  pool_invalidatewhatprovides(pool);
 }
 
 static int
@@ -263,46 +276,314 @@ pool_shrink_whatprovides(Pool *pool)
 }
 
 
+/* does solvable s go into the whatprovides data? */
+static inline int
+whatprovides_indexed(Pool *pool, Solvable *s)
+{
+  if (!s->provides || !s->repo || s->repo->disabled)
+    return 0;
+  /* we always need the installed solvable in the whatprovides data,
+     otherwise obsoletes/conflicts on them won't work */
+  if (s->repo != pool->installed && !pool_installable(pool, s))
+    return 0;
+  return 1;
+}
+
+static int
+whatprovides_pair_sortcmp(const void *ap, const void *bp, void *dp)
+{
+  const Id *a = ap, *b = bp;
+  if (a[0] != b[0])
+    return a[0] - b[0];
+  return a[1] - b[1];
+}
+
+/* can we still use the data of the relation providers of dep? */
+static inline int
+whatprovides_depchanged(Map *changed, Map *relchanged, Id dep)
+{
+  if (ISRELDEP(dep))
+    return MAPTST(relchanged, GETRELID(dep));
+  return MAPTST(changed, dep);
+}
+
 /*
- * pool_createwhatprovides()
- * 
- * create hashes over pool of solvables to ease provide lookups
- * 
+ * update the whatprovides data after solvables were added or removed
+ *
+ * We compare the set of indexed solvables with the one we created the
+ * data for. A repo whose idarraysize changed is treated as if all of
+ * its solvables were removed and added again. Only the provider lists
+ * of names with removed or added providers get rewritten (at the end
+ * of whatprovidesdata, the old lists stay as garbage), and only the
+ * relation providers depending on such a name are dropped.
+ *
+ * returns 0 if a full creation is cheaper
  */
-void
-pool_createwhatprovides(Pool *pool)
+static int
+pool_updatewhatprovides(Pool *pool)
+{
+  Map *indexed = &pool->whatprovidesmap;
+  Map removed, added, changed, relchanged, seen;
+  Queue q, oldlists;
+  Solvable *s;
+  Repo *repo;
+  Id p, id, *pp, *pairs, *pairp, *pairend;
+  Offset need, n;
+  int i, nsolvables, nremoved, nadded, npairs, nchanged, nrelchanged, isindexed;
+  unsigned int now;
+
+  if (!indexed->size || pool->whatprovidesdead > pool->whatprovidesdataoff / 2)
+    return 0;	/* too much garbage */
+  now = sat_timems(0);
+
+  /* ids and relations may have been added without growing our arrays */
+  if (pool->ss.nstrings > pool->whatprovidesnstrings)
+    {
+      pool->whatprovides = sat_extend_resize(pool->whatprovides, pool->ss.nstrings, sizeof(Offset), WHATPROVIDES_BLOCK);
+      memset(pool->whatprovides + pool->whatprovidesnstrings, 0, (pool->ss.nstrings - pool->whatprovidesnstrings) * sizeof(Offset));
+    }
+  if (pool->nrels > pool->whatprovidesnrels)
+    {
+      pool->whatprovides_rel = sat_extend_resize(pool->whatprovides_rel, pool->nrels, sizeof(Offset), WHATPROVIDES_BLOCK);
+      memset(pool->whatprovides_rel + pool->whatprovidesnrels, 0, (pool->nrels - pool->whatprovidesnrels) * sizeof(Offset));
+    }
+
+  /* find the solvables that changed. The pool may also have shrunk. */
+  nsolvables = indexed->size << 3;
+  if (nsolvables < pool->nsolvables)
+    nsolvables = pool->nsolvables;
+  map_init(&removed, nsolvables);
+  map_init(&added, nsolvables);
+  nremoved = nadded = npairs = 0;
+  for (p = 2, s = pool->solvables + p; p < nsolvables; p++, s++)
+    {
+      isindexed = p < indexed->size << 3 && MAPTST(indexed, p);
+      if (p < pool->nsolvables && whatprovides_indexed(pool, s))
+	{
+	  if (isindexed && s->repo->whatprovidessize == s->repo->idarraysize)
+	    continue;
+	  MAPSET(&added, p);
+	  nadded++;
+	  for (pp = s->repo->idarraydata + s->provides; *pp++; )
+	    npairs++;
+	}
+      if (isindexed)
+	{
+	  MAPSET(&removed, p);
+	  nremoved++;
+	}
+    }
+  if (2 * (nadded + nremoved) > pool->nsolvables)
+    {
+      map_free(&removed);
+      map_free(&added);
+      return 0;
+    }
+
+  /* the (name, solvable) pairs we have to add */
+  pairs = pairp = sat_malloc2(npairs, 2 * sizeof(Id));
+  for (p = 2, s = pool->solvables + p; nadded && p < pool->nsolvables; p++, s++)
+    {
+      if (!MAPTST(&added, p))
+	continue;
+      for (pp = s->repo->idarraydata + s->provides; (id = *pp++) != 0; )
+	{
+	  while (ISRELDEP(id))
+	    {
+	      Reldep *rd = GETRELDEP(pool, id);
+	      id = rd->name;
+	    }
+	  *pairp++ = id;
+	  *pairp++ = p;
+	}
+    }
+  sat_sort(pairs, npairs, 2 * sizeof(Id), whatprovides_pair_sortcmp, pool);
+
+  /* find the names whose providers change */
+  map_init(&changed, pool->ss.nstrings);
+  for (i = 0; i < npairs; i++)
+    MAPSET(&changed, pairs[2 * i]);
+  if (nremoved)
+    {
+      for (id = 1; id < pool->ss.nstrings; id++)
+	{
+	  if (pool->whatprovides[id] <= 1 || MAPTST(&changed, id))
+	    continue;
+	  for (pp = pool->whatprovidesdata + pool->whatprovides[id]; (p = *pp) != 0; pp++)
+	    if (MAPTST(&removed, p))
+	      break;
+	  if (p)
+	    MAPSET(&changed, id);
+	}
+    }
+
+  /* make room for the new lists */
+  queue_init(&oldlists);
+  need = npairs;
+  for (id = 1; id < pool->ss.nstrings; id++)
+    {
+      if (!MAPTST(&changed, id))
+	continue;
+      need++;
+      if (pool->whatprovides[id] <= 1)
+	continue;
+      for (pp = pool->whatprovidesdata + pool->whatprovides[id], n = 1; *pp; pp++)
+	n++;
+      need += n;
+      queue_push(&oldlists, pool->whatprovides[id]);
+    }
+  if (pool->whatprovidesdataleft < need)
+    {
+      pool->whatprovidesdata = sat_realloc2(pool->whatprovidesdata, pool->whatprovidesdataoff + need + 4096, sizeof(Id));
+      pool->whatprovidesdataleft = need + 4096;
+    }
+
+  /* merge the old providers with the added ones */
+  queue_init(&q);
+  nchanged = 0;
+  pairp = pairs;
+  pairend = pairs + 2 * npairs;
+  for (id = 1; id < pool->ss.nstrings; id++)
+    {
+      if (!MAPTST(&changed, id))
+	continue;
+      nchanged++;
+      queue_empty(&q);
+      pp = pool->whatprovides[id] > 1 ? pool->whatprovidesdata + pool->whatprovides[id] : 0;
+      for (;;)
+	{
+	  while (pp && *pp && MAPTST(&removed, *pp))
+	    pp++;
+	  if (pp && *pp && (pairp == pairend || pairp[0] != id || *pp < pairp[1]))
+	    p = *pp++;
+	  else if (pairp != pairend && pairp[0] == id)
+	    {
+	      p = pairp[1];
+	      pairp += 2;
+	    }
+	  else
+	    break;
+	  if (!q.count || q.elements[q.count - 1] != p)	/* don't add same solvable twice */
+	    queue_push(&q, p);
+	}
+      pool->whatprovides[id] = q.count ? pool_queuetowhatprovides(pool, &q) : 0;
+    }
+  queue_free(&q);
+  sat_free(pairs);
+
+  /* drop the relation providers that depend on a changed name */
+  map_init(&relchanged, pool->nrels);
+  nrelchanged = 0;
+  for (id = 1; id < pool->nrels; id++)
+    {
+      Reldep *rd = pool->rels + id;
+      int stale;
+      if (!pool->whatprovides_rel[id])
+	continue;
+      switch (rd->flags)
+	{
+	case REL_AND:
+	case REL_OR:
+	case REL_WITH:
+	  stale = whatprovides_depchanged(&changed, &relchanged, rd->name) || whatprovides_depchanged(&changed, &relchanged, rd->evr);
+	  break;
+	case REL_NAMESPACE:
+	  /* we don't know what the callback looks at */
+	  stale = rd->name == NAMESPACE_OTHERPROVIDERS ? whatprovides_depchanged(&changed, &relchanged, rd->evr) : 1;
+	  break;
+	case REL_ARCH:
+	  /* src packages are searched in the complete pool */
+	  stale = rd->evr == ARCH_SRC ? 1 : whatprovides_depchanged(&changed, &relchanged, rd->name);
+	  break;
+	default:
+	  stale = whatprovides_depchanged(&changed, &relchanged, rd->name);
+	  break;
+	}
+      if (stale)
+	{
+	  MAPSET(&relchanged, id);
+	  if (pool->whatprovides_rel[id] > 1)
+	    queue_push(&oldlists, pool->whatprovides_rel[id]);
+	  pool->whatprovides_rel[id] = 0;
+	  nrelchanged++;
+	}
+    }
+
+  /* count the replaced and dropped lists as garbage. Lists can be
+   * shared by names and relations, so only the ones nobody uses any
+   * more are garbage, and each of them only once. */
+  if (oldlists.count)
+    {
+      map_init(&seen, pool->whatprovidesdataoff);
+      for (id = 1; id < pool->ss.nstrings; id++)
+	if (pool->whatprovides[id] > 1)
+	  MAPSET(&seen, pool->whatprovides[id]);
+      for (id = 1; id < pool->nrels; id++)
+	if (pool->whatprovides_rel[id] > 1)
+	  MAPSET(&seen, pool->whatprovides_rel[id]);
+      for (i = 0; i < oldlists.count; i++)
+	{
+	  if (MAPTST(&seen, oldlists.elements[i]))
+	    continue;
+	  MAPSET(&seen, oldlists.elements[i]);
+	  for (pp = pool->whatprovidesdata + oldlists.elements[i], n = 1; *pp; pp++)
+	    n++;
+	  pool->whatprovidesdead += n;
+	}
+      map_free(&seen);
+    }
+  queue_free(&oldlists);
+
+  /* remember the new state */
+  map_grow(indexed, pool->nsolvables);
+  for (p = 2; p < nsolvables; p++)
+    {
+      if (MAPTST(&removed, p))
+	MAPCLR(indexed, p);
+      if (MAPTST(&added, p))
+	MAPSET(indexed, p);
+    }
+  FOR_REPOS(i, repo)
+    repo->whatprovidessize = repo->idarraysize;
+  pool->whatprovidesnstrings = pool->ss.nstrings;
+  pool->whatprovidesnrels = pool->nrels;
+  if (nchanged || nrelchanged)
+    {
+      /* users of the old data must not keep it */
+      pool->whatprovidesgen++;
+      pool_freewhatrequires(pool);
+    }
+  POOL_DEBUG(SAT_DEBUG_STATS, "updated whatprovides: %d added, %d removed solvables, %d names, %d relations changed\n", nadded, nremoved, nchanged, nrelchanged);
+  map_free(&removed);
+  map_free(&added);
+  map_free(&changed);
+  map_free(&relchanged);
+  pool->whatprovidesstale = 0;
+  POOL_DEBUG(SAT_DEBUG_STATS, "updatewhatprovides took %d ms\n", sat_timems(now));
+  return 1;
+}
+
+/* returns the data with room for extra more entries, *offp is set to the used size */
+static Id *
+createwhatprovides_serial(Pool *pool, int extra, Offset *offp)
 {
-  int i, num, np, extra;
+  int i, num, np;
   Offset off;
   Solvable *s;
   Id id;
   Offset *idp, n;
-  Offset *whatprovides;
+  Offset *whatprovides = pool->whatprovides;
   Id *whatprovidesdata, *d;
-  Repo *installed = pool->installed;
-  unsigned int now;
-
-  now = sat_timems(0);
-  POOL_DEBUG(SAT_DEBUG_STATS, "number of solvables: %d\n", pool->nsolvables);
-  POOL_DEBUG(SAT_DEBUG_STATS, "number of ids: %d + %d\n", pool->ss.nstrings, pool->nrels);
 
-  pool_freeidhashes(pool);	/* XXX: should not be here! */
-  pool_freewhatprovides(pool);
   num = pool->ss.nstrings;
-  pool->whatprovides = whatprovides = sat_calloc_block(num, sizeof(Offset), WHATPROVIDES_BLOCK);
-  pool->whatprovides_rel = sat_calloc_block(pool->nrels, sizeof(Offset), WHATPROVIDES_BLOCK);
-
   /* count providers for each name */
   for (i = pool->nsolvables - 1; i > 0; i--)
     {
       Id *pp;
       s = pool->solvables + i;
-      if (!s->provides || !s->repo || s->repo->disabled)
-	continue;
-      /* we always need the installed solvable in the whatprovides data,
-         otherwise obsoletes/conflicts on them won't work */
-      if (s->repo != installed && !pool_installable(pool, s))
+      if (!whatprovides_indexed(pool, s))
 	continue;
+      MAPSET(&pool->whatprovidesmap, i);
       pp = s->repo->idarraydata + s->provides;
       while ((id = *pp++) != 0)
 	{
@@ -328,12 +609,6 @@ pool_createwhatprovides(Pool *pool)
     }
 
   POOL_DEBUG(SAT_DEBUG_STATS, "provide ids: %d\n", np);
-
-  /* reserve some space for relation data */
-  extra = 2 * pool->nrels;
-  if (extra < 256)
-    extra = 256;
-
   POOL_DEBUG(SAT_DEBUG_STATS, "provide space needed: %d + %d\n", off, extra);
 
   /* alloc space for all providers + extra */
@@ -343,11 +618,9 @@ pool_createwhatprovides(Pool *pool)
   for (i = pool->nsolvables - 1; i > 0; i--)
     {
       Id *pp;
-      s = pool->solvables + i;
-      if (!s->provides || !s->repo || s->repo->disabled)
-	continue;
-      if (s->repo != installed && !pool_installable(pool, s))
+      if (!MAPTST(&pool->whatprovidesmap, i))
 	continue;
+      s = pool->solvables + i;
 
       /* for all provides of this solvable */
       pp = s->repo->idarraydata + s->provides;
@@ -366,10 +639,312 @@ pool_createwhatprovides(Pool *pool)
 	    }
 	}
     }
+  *offp = off;
+  return whatprovidesdata;
+}
+
+/*
+ * parallel creation of the whatprovides data
+ *
+ * The solvables are split into chunks, each thread counts the
+ * providers of its chunk. The list of a name then gets one slice
+ * per thread, in chunk order, so the providers stay sorted like
+ * in the serial loop. Every slice but the first starts with a zero
+ * slot, so a thread only looks at its own data when skipping
+ * duplicate provides. The zero slots are squeezed out at the end.
+ */
+
+#define WHATPROVIDES_PARALLEL_MIN	4096	/* min solvables per thread */
+
+struct whatprovidesworker {
+  Pool *pool;
+  Offset **pos;		/* per thread provider counts, then fill positions */
+  Id *data;
+  int nthreads;
+  int t;
+  Id sstart, send;	/* solvable range */
+  Id idstart, idend;	/* name range */
+  Offset off;		/* data offset of the name range */
+  int np;
+};
+
+/* run worker on nthreads structs of size wsize */
+static void
+runworkers(void *workers, size_t wsize, int nthreads, void *(*worker)(void *))
+{
+  pthread_t *threads;
+  int t, nstarted;
+
+  /* the calling thread does the first chunk */
+  threads = sat_calloc(nthreads, sizeof(pthread_t));
+  for (nstarted = 1; nstarted < nthreads; nstarted++)
+    if (pthread_create(threads + nstarted, 0, worker, (char *)workers + nstarted * wsize) != 0)
+      break;
+  for (t = nstarted; t < nthreads; t++)
+    worker((char *)workers + t * wsize);
+  worker(workers);
+  for (t = 1; t < nstarted; t++)
+    pthread_join(threads[t], 0);
+  sat_free(threads);
+}
+
+static void *
+whatprovides_count_worker(void *data)
+{
+  struct whatprovidesworker *w = data;
+  Pool *pool = w->pool;
+  Offset *cnt = w->pos[w->t];
+  Solvable *s;
+  Id i, id, *pp;
+
+  for (i = w->sstart; i < w->send; i++)
+    {
+      s = pool->solvables + i;
+      if (!whatprovides_indexed(pool, s))
+	continue;
+      MAPSET(&pool->whatprovidesmap, i);	/* chunks start at byte boundaries */
+      pp = s->repo->idarraydata + s->provides;
+      while ((id = *pp++) != 0)
+	{
+	  while (ISRELDEP(id))
+	    {
+	      Reldep *rd = GETRELDEP(pool, id);
+	      id = rd->name;
+	    }
+	  cnt[id]++;
+	}
+    }
+  return 0;
+}
+
+static void *
+whatprovides_size_worker(void *data)
+{
+  struct whatprovidesworker *w = data;
+  Offset n, c;
+  Id id;
+  int t;
+
+  for (id = w->idstart; id < w->idend; id++)
+    {
+      n = 0;
+      for (t = 0; t < w->nthreads; t++)
+	if ((c = w->pos[t][id]) != 0)
+	  n += n ? c + 1 : c;
+      if (!n)
+	continue;
+      w->off += n + 1;
+      w->np++;
+    }
+  return 0;
+}
+
+static void *
+whatprovides_offset_worker(void *data)
+{
+  struct whatprovidesworker *w = data;
+  Offset *whatprovides = w->pool->whatprovides;
+  Offset off = w->off, o, c;
+  Id id;
+  int t;
+
+  for (id = w->idstart; id < w->idend; id++)
+    {
+      o = off;
+      for (t = 0; t < w->nthreads; t++)
+	{
+	  c = w->pos[t][id];
+	  if (c && off != o)
+	    off++;		/* zero slot in front of the slice */
+	  w->pos[t][id] = off;
+	  off += c;
+	}
+      if (off != o)
+	{
+	  whatprovides[id] = o;
+	  off++;		/* terminating zero */
+	}
+    }
+  return 0;
+}
+
+static void *
+whatprovides_fill_worker(void *data)
+{
+  struct whatprovidesworker *w = data;
+  Pool *pool = w->pool;
+  Offset *pos = w->pos[w->t];
+  Solvable *s;
+  Id i, id, *pp, *d;
+
+  for (i = w->sstart; i < w->send; i++)
+    {
+      if (!MAPTST(&pool->whatprovidesmap, i))
+	continue;
+      s = pool->solvables + i;
+      pp = s->repo->idarraydata + s->provides;
+      while ((id = *pp++) != 0)
+	{
+	  while (ISRELDEP(id))
+	    {
+	      Reldep *rd = GETRELDEP(pool, id);
+	      id = rd->name;
+	    }
+	  d = w->data + pos[id];
+	  if (d[-1] != i)	/* don't add same solvable twice */
+	    {
+	      *d = i;
+	      pos[id]++;
+	    }
+	}
+    }
+  return 0;
+}
+
+static void *
+whatprovides_squeeze_worker(void *data)
+{
+  struct whatprovidesworker *w = data;
+  Offset *whatprovides = w->pool->whatprovides;
+  Offset *lastpos = w->pos[w->nthreads - 1];
+  Id id, *dp, *sp, *ep;
+
+  for (id = w->idstart; id < w->idend; id++)
+    {
+      if (!whatprovides[id])
+	continue;
+      dp = sp = w->data + whatprovides[id];
+      ep = w->data + lastpos[id];
+      for (; sp < ep; sp++)
+	if (*sp)
+	  *dp++ = *sp;
+      while (dp < ep)
+	*dp++ = 0;
+    }
+  return 0;
+}
+
+static Id *
+createwhatprovides_parallel(Pool *pool, int nthreads, int extra, Offset *offp)
+{
+  struct whatprovidesworker *workers, *w;
+  Offset **pos, off;
+  Id *whatprovidesdata;
+  int t, np, num = pool->ss.nstrings;
+
+  pos = sat_calloc(nthreads, sizeof(Offset *));
+  for (t = 0; t < nthreads; t++)
+    pos[t] = sat_calloc(num, sizeof(Offset));
+  workers = sat_calloc(nthreads, sizeof(*workers));
+  for (t = 0; t < nthreads; t++)
+    {
+      w = workers + t;
+      w->pool = pool;
+      w->pos = pos;
+      w->nthreads = nthreads;
+      w->t = t;
+      /* different threads must not set bits in the same map byte */
+      w->sstart = ((long long)pool->nsolvables * t / nthreads) & ~7;
+      w->idstart = (long long)num * t / nthreads;
+      w->idend = (long long)num * (t + 1) / nthreads;
+      if (t)
+	workers[t - 1].send = w->sstart;
+    }
+  workers[0].sstart = 1;
+  workers[nthreads - 1].send = pool->nsolvables;
+
+  runworkers(workers, sizeof(*workers), nthreads, whatprovides_count_worker);
+  runworkers(workers, sizeof(*workers), nthreads, whatprovides_size_worker);
+  off = 2;	/* first entry is undef, second is empty list */
+  np = 0;
+  for (t = 0; t < nthreads; t++)
+    {
+      Offset n = workers[t].off;
+      workers[t].off = off;
+      off += n;
+      np += workers[t].np;
+    }
+  runworkers(workers, sizeof(*workers), nthreads, whatprovides_offset_worker);
+  POOL_DEBUG(SAT_DEBUG_STATS, "provide ids: %d\n", np);
+  POOL_DEBUG(SAT_DEBUG_STATS, "provide space needed: %d + %d\n", off, extra);
+
+  whatprovidesdata = sat_calloc(off + extra, sizeof(Id));
+  for (t = 0; t < nthreads; t++)
+    workers[t].data = whatprovidesdata;
+  runworkers(workers, sizeof(*workers), nthreads, whatprovides_fill_worker);
+  runworkers(workers, sizeof(*workers), nthreads, whatprovides_squeeze_worker);
+
+  for (t = 0; t < nthreads; t++)
+    sat_free(pos[t]);
+  sat_free(pos);
+  sat_free(workers);
+  *offp = off;
+  return whatprovidesdata;
+}
+
+/*
+ * pool_createwhatprovides()
+ * 
+ * create hashes over pool of solvables to ease provide lookups
+ * 
+ * If the data already exists and only some solvables were added,
+ * removed or disabled since the last call, it gets updated instead.
+ * Call pool_freewhatprovides() first if the provides of existing
+ * solvables or the dependency matching options were changed, that
+ * makes sure that everything is created from scratch.
+ * Big pools are created with pool->whatprovidesthreads threads.
+ * The evr ranks are brought up to date if they were created.
+ */
+void
+pool_createwhatprovides(Pool *pool)
+{
+  int i, num, extra, nthreads;
+  Offset off;
+  Id *whatprovidesdata;
+  Repo *repo;
+  unsigned int now;
+
+  POOL_CHECK_THAWED(pool);
+  now = sat_timems(0);
+  POOL_DEBUG(SAT_DEBUG_STATS, "number of solvables: %d\n", pool->nsolvables);
+  POOL_DEBUG(SAT_DEBUG_STATS, "number of ids: %d + %d\n", pool->ss.nstrings, pool->nrels);
+
+  pool_freeidhashes(pool);	/* XXX: should not be here! */
+  if (pool->evrranks)
+    pool_createevrranks(pool);
+  if (pool->whatprovides && pool->relprovidersmax && pool->relprovidersdata > pool->relprovidersmax)
+    {
+      POOL_DEBUG(SAT_DEBUG_STATS, "relation providers use %d entries, dropping them\n", pool->relprovidersdata);
+      pool_freewhatprovides(pool);
+    }
+  if (pool->whatprovides && pool_updatewhatprovides(pool))
+    return;
+  pool_freewhatprovides(pool);
+  num = pool->ss.nstrings;
+  pool->whatprovides = sat_calloc_block(num, sizeof(Offset), WHATPROVIDES_BLOCK);
+  pool->whatprovides_rel = sat_calloc_block(pool->nrels, sizeof(Offset), WHATPROVIDES_BLOCK);
+  map_init(&pool->whatprovidesmap, pool->nsolvables);
+
+  /* reserve some space for relation data */
+  extra = 2 * pool->nrels;
+  if (extra < 256)
+    extra = 256;
+
+  nthreads = pool->whatprovidesthreads;
+  if (nthreads > pool->nsolvables / WHATPROVIDES_PARALLEL_MIN)
+    nthreads = pool->nsolvables / WHATPROVIDES_PARALLEL_MIN;
+  if (nthreads > 1)
+    whatprovidesdata = createwhatprovides_parallel(pool, nthreads, extra, &off);
+  else
+    whatprovidesdata = createwhatprovides_serial(pool, extra, &off);
   pool->whatprovidesdata = whatprovidesdata;
   pool->whatprovidesdataoff = off;
   pool->whatprovidesdataleft = extra;
   pool_shrink_whatprovides(pool);
+  FOR_REPOS(i, repo)
+    repo->whatprovidessize = repo->idarraysize;
+  pool->whatprovidesnstrings = num;
+  pool->whatprovidesnrels = pool->nrels;
   POOL_DEBUG(SAT_DEBUG_STATS, "whatprovides memory used: %d K id array, %d K data\n", (pool->ss.nstrings + pool->nrels + WHATPROVIDES_BLOCK) / (int)(1024/sizeof(Id)), (pool->whatprovidesdataoff + pool->whatprovidesdataleft) / (int)(1024/sizeof(Id)));
   POOL_DEBUG(SAT_DEBUG_STATS, "createwhatprovides took %d ms\n", sat_timems(now));
 }
@@ -382,11 +957,156 @@ pool_createwhatprovides(Pool *pool)
 void
 pool_freewhatprovides(Pool *pool)
 {
+  POOL_CHECK_THAWED(pool);
   pool->whatprovides = sat_free(pool->whatprovides);
   pool->whatprovides_rel = sat_free(pool->whatprovides_rel);
   pool->whatprovidesdata = sat_free(pool->whatprovidesdata);
   pool->whatprovidesdataoff = 0;
   pool->whatprovidesdataleft = 0;
+  pool->whatprovidesgen++;
+  pool->whatprovidesstale = 0;
+  pool->whatprovidesdead = 0;
+  pool->relprovidersdata = 0;
+  map_free(&pool->whatprovidesmap);
+  pool_freewhatrequires(pool);
+}
+
+/*
+ * note that solvables were added or removed
+ * unlike pool_freewhatprovides(), this keeps the data around so that
+ * the next pool_createwhatprovides() can update it. Until then the
+ * data must not be used.
+ */
+void
+pool_invalidatewhatprovides(Pool *pool)
+{
+  POOL_CHECK_THAWED(pool);
+  if (!pool->whatprovides)
+    return;
+  pool->whatprovidesstale = 1;
+  pool->whatprovidesgen++;
+  pool_freewhatrequires(pool);
+}
+
+
+/******************************************************************************/
+
+/*
+ * reverse dependencies
+ *
+ * for every solvable the lists of solvables that require, recommend or
+ * supplement one of its provides. This is the inverse of FOR_PROVIDES
+ * over the dependencies of all solvables, so users like the cleandeps
+ * code or the solver's supplements check only need to look at the
+ * solvables that are affected.
+ */
+
+/* add (count) solvable i to list n of solvable p */
+static inline void
+addwhatrequiresentry(Offset *whatrequires, Id *data, Id *last, int n, Id p, Id i)
+{
+  p = 3 * p + n;
+  if (last[p] == i)
+    return;		/* don't add same solvable twice */
+  last[p] = i;
+  if (data)
+    data[--whatrequires[p]] = i;
+  else
+    whatrequires[p]++;
+}
+
+/* add (count) solvable i to the lists of the providers of dep */
+static void
+addwhatrequires(Pool *pool, Offset *whatrequires, Id *data, Id *last, int n, Id i, Id dep)
+{
+  Id p, pp;
+
+  if (n == 2 && ISRELDEP(dep))
+    {
+      /* a supplements of "a & b" depends on the providers of both */
+      Reldep *rd = GETRELDEP(pool, dep);
+      if (rd->flags == REL_AND)
+	{
+	  addwhatrequires(pool, whatrequires, data, last, n, i, rd->name);
+	  addwhatrequires(pool, whatrequires, data, last, n, i, rd->evr);
+	  return;
+	}
+      /* the solver does not look at the providers of these to decide
+       * if they are fulfilled, so also file them under the always
+       * installed system solvable */
+      if (rd->flags == REL_NAMESPACE && (rd->name == NAMESPACE_SPLITPROVIDES || rd->name == NAMESPACE_INSTALLED))
+	addwhatrequiresentry(whatrequires, data, last, n, SYSTEMSOLVABLE, i);
+    }
+  FOR_PROVIDES(p, pp, dep)
+    addwhatrequiresentry(whatrequires, data, last, n, p, i);
+}
+
+void
+pool_createwhatrequires(Pool *pool)
+{
+  Offset *whatrequires, off, n;
+  Id *data, *last, *dp, dep;
+  Solvable *s;
+  int i, k, pass, num;
+  unsigned int now;
+
+  POOL_CHECK_THAWED(pool);
+  now = sat_timems(0);
+  if (!pool->whatprovides || pool->whatprovidesstale)
+    pool_createwhatprovides(pool);
+  pool_freewhatrequires(pool);
+  num = 3 * pool->nsolvables;
+  whatrequires = sat_calloc(num, sizeof(Offset));
+  last = sat_calloc(num, sizeof(Id));
+  data = 0;
+  /* first pass counts, second pass fills the lists from the end */
+  for (pass = 0; pass < 2; pass++)
+    {
+      if (pass)
+	{
+	  /* reserve an empty list at offset 0 and a terminator for every list */
+	  for (i = 0, off = 1; i < num; i++)
+	    {
+	      if (!whatrequires[i])
+		continue;
+	      n = whatrequires[i];
+	      whatrequires[i] = off + n;
+	      off += n + 1;
+	    }
+	  data = sat_calloc(off, sizeof(Id));
+	  memset(last, 0, num * sizeof(Id));
+	  POOL_DEBUG(SAT_DEBUG_STATS, "whatrequires memory used: %d K id array, %d K data\n", num / (int)(1024/sizeof(Offset)), off / (int)(1024/sizeof(Id)));
+	}
+      for (i = pool->nsolvables - 1; i > 1; i--)
+	{
+	  s = pool->solvables + i;
+	  if (!s->repo)
+	    continue;
+	  for (k = 0; k < 3; k++)
+	    {
+	      off = k == 0 ? s->requires : k == 1 ? s->recommends : s->supplements;
+	      if (!off)
+		continue;
+	      for (dp = s->repo->idarraydata + off; (dep = *dp++) != 0; )
+		if (dep != SOLVABLE_PREREQMARKER)
+		  addwhatrequires(pool, whatrequires, data, last, k, i, dep);
+	    }
+	}
+    }
+  sat_free(last);
+  pool->whatrequires = whatrequires;
+  pool->whatrequiresdata = data;
+  pool->nwhatrequires = pool->nsolvables;
+  POOL_DEBUG(SAT_DEBUG_STATS, "createwhatrequires took %d ms\n", sat_timems(now));
+}
+
+void
+pool_freewhatrequires(Pool *pool)
+{
+  POOL_CHECK_THAWED(pool);
+  pool->whatrequires = sat_free(pool->whatrequires);
+  pool->whatrequiresdata = sat_free(pool->whatrequiresdata);
+  pool->nwhatrequires = 0;
 }
 
 
@@ -409,6 +1129,7 @@ pool_queuetowhatprovides(Pool *pool, Queue *q)
 
   if (count == 0)		       /* queue empty -> 1 */
     return 1;
+  POOL_CHECK_THAWED(pool);
 
   /* extend whatprovidesdata if needed, +1 for ID_NULL-termination */
   if (pool->whatprovidesdataleft < count + 1)
@@ -540,6 +1261,103 @@ pool_match_dep(Pool *pool, Id d1, Id d2)
   return pool_match_flags_evr(pool, rd1->flags, rd1->evr, rd2->flags, rd2->evr);
 }
 
+/*
+ * the providers of a simple version comparison relation
+ * Only reads the pool if the name of the relation is not
+ * a relation itself.
+ */
+static void
+addrelproviders_cmp(Pool *pool, Id d, Queue *plist)
+{
+  Reldep *rd = pool->rels + d;
+  Reldep *prd;
+  Id name = rd->name;
+  Id evr = rd->evr;
+  int flags = rd->flags;
+  Id pid, *pidp;
+  Id p, *pp;
+
+#if 0
+  POOL_DEBUG(SAT_DEBUG_STATS, "addrelproviders: what provides %s?\n", dep2str(pool, name));
+#endif
+  pp = pool_whatprovides_ptr(pool, name);
+  while (ISRELDEP(name))
+    {
+      rd = GETRELDEP(pool, name);
+      name = rd->name;
+    }
+  while ((p = *pp++) != 0)
+    {
+      Solvable *s = pool->solvables + p;
+      if (!s->provides)
+	{
+	  /* no provides - check nevr */
+	  if (pool_match_nevr_rel(pool, s, MAKERELDEP(d)))
+	    queue_push(plist, p);
+	  continue;
+	}
+      /* solvable p provides name in some rels */
+      pidp = s->repo->idarraydata + s->provides;
+      while ((pid = *pidp++) != 0)
+	{
+	  if (pid == name)
+	    {
+#if defined(MULTI_SEMANTICS)
+	      if (pool->disttype == DISTTYPE_DEB)
+		continue;
+	      else
+		break;
+#elif defined(DEBIAN_SEMANTICS)
+	      continue;		/* unversioned provides can
+				 * never match versioned deps */
+#else
+	      break;		/* yes, provides all versions */
+#endif
+	    }
+	  if (!ISRELDEP(pid))
+	    continue;		/* wrong provides name */
+	  prd = GETRELDEP(pool, pid);
+	  if (prd->name != name)
+	    continue;		/* wrong provides name */
+	  /* right package, both deps are rels. check flags/evr */
+	  if (pool_match_flags_evr(pool, prd->flags, prd->evr, flags, evr))
+	    break;	/* matches */
+	}
+      if (!pid)
+	continue;	/* none of the providers matched */
+      queue_push(plist, p);
+    }
+  /* make our system solvable provide all unknown rpmlib() stuff */
+  if (plist->count == 0 && !strncmp(id2str(pool, name), "rpmlib(", 7))
+    queue_push(plist, SYSTEMSOLVABLE);
+}
+
+/*
+ * store the providers of relation d
+ * A list that is the same as the providers of the relation name
+ * is shared with the name.
+ */
+static Id
+storerelproviders(Pool *pool, Id d, Queue *q)
+{
+  Reldep *rd = pool->rels + d;
+  Id *pp;
+  int i;
+
+  if (q->count && !ISRELDEP(rd->name) && pool->whatprovides[rd->name] > 1)
+    {
+      pp = pool->whatprovidesdata + pool->whatprovides[rd->name];
+      for (i = 0; i < q->count; i++)
+	if (pp[i] != q->elements[i])
+	  break;
+      if (i == q->count && !pp[i])
+	return pool->whatprovides_rel[d] = pool->whatprovides[rd->name];
+    }
+  if (q->count)
+    pool->relprovidersdata += q->count + 1;
+  return pool->whatprovides_rel[d] = pool_queuetowhatprovides(pool, q);
+}
+
 /*
  * addrelproviders
  * 
@@ -548,28 +1366,29 @@ pool_match_dep(Pool *pool, Id d1, Id d2)
  * 
  */
 
-Id
-pool_addrelproviders(Pool *pool, Id d)
+static Id
+addrelproviders(Pool *pool, Id d)
 {
   Reldep *rd = GETRELDEP(pool, d);
-  Reldep *prd;
   Queue plist;
   Id buf[16];
   Id name = rd->name;
   Id evr = rd->evr;
   int flags = rd->flags;
   Id pid, *pidp;
-  Id p, *pp;
+  Id p, *pp, wp;
 
+  POOL_CHECK_THAWED(pool);
   d = GETRELID(d);
   queue_init_buffer(&plist, buf, sizeof(buf)/sizeof(*buf));
 
   if (flags >= 8)
     {
       /* special relation */
-      Id wp = 0;
       Id *pp2, *pp3;
 
+      wp = 0;
+
       switch (flags)
 	{
 	case REL_AND:
@@ -682,70 +1501,250 @@ pool_addrelproviders(Pool *pool, Id d)
 	}
     }
   else if (flags)
-    {
-      /* simple version comparison relation */
+    addrelproviders_cmp(pool, d, &plist);
+  /* add providers to whatprovides */
 #if 0
-      POOL_DEBUG(SAT_DEBUG_STATS, "addrelproviders: what provides %s?\n", dep2str(pool, name));
+  POOL_DEBUG(SAT_DEBUG_STATS, "addrelproviders: adding %d packages to %d\n", plist.count, d);
 #endif
-      pp = pool_whatprovides_ptr(pool, name);
-      while (ISRELDEP(name))
+  wp = storerelproviders(pool, d, &plist);
+  queue_free(&plist);
+
+  return wp;
+}
+
+/* called by pool_whatprovides() for relations whose providers are
+ * not known yet */
+Id
+pool_addrelproviders(Pool *pool, Id d)
+{
+  POOL_CHECK_THAWED(pool);
+  pool->relprovidersmisses++;
+  return addrelproviders(pool, d);
+}
+
+/*
+ * pool_createrelproviders - compute relation providers in advance
+ *
+ * Computes the providers of the relations used in the requires,
+ * conflicts and obsoletes of the solvables, so that solving does not
+ * have to do it on first use. The version comparisons are done by
+ * pool->whatprovidesthreads threads. The results are stored in
+ * relation order, so the data is the same as with a single thread.
+ * Stops if the relprovidersmax limit is reached.
+ */
+
+#define RELPROVIDERS_PARALLEL_MIN	256	/* min relations per thread */
+#define RELPROVIDERS_BLOCK		4095
+
+struct relprovidersworker {
+  Pool *pool;
+  Id *rels;
+  int start, end;
+  int *dataend;		/* end offset into data for each relation, -1: not done */
+  Id *data;
+  int ndata;
+};
+
+static void *
+relproviders_worker(void *data)
+{
+  struct relprovidersworker *w = data;
+  Pool *pool = w->pool;
+  Reldep *rd;
+  Queue plist;
+  Id buf[16];
+  int i;
+
+  queue_init_buffer(&plist, buf, sizeof(buf)/sizeof(*buf));
+  for (i = w->start; i < w->end; i++)
+    {
+      rd = pool->rels + w->rels[i];
+      if (!rd->flags || rd->flags >= 8 || ISRELDEP(rd->name))
 	{
-          rd = GETRELDEP(pool, name);
-	  name = rd->name;
+	  w->dataend[i] = -1;	/* needs a pool that can be modified */
+	  continue;
 	}
-      while ((p = *pp++) != 0)
+      queue_empty(&plist);
+      addrelproviders_cmp(pool, w->rels[i], &plist);
+      w->data = sat_extend(w->data, w->ndata, plist.count, sizeof(Id), RELPROVIDERS_BLOCK);
+      memcpy(w->data + w->ndata, plist.elements, plist.count * sizeof(Id));
+      w->ndata += plist.count;
+      w->dataend[i] = w->ndata;
+    }
+  queue_free(&plist);
+  return 0;
+}
+
+static inline void
+markrelproviders(Pool *pool, Map *m, Offset deps, Id *idarraydata)
+{
+  Id id, *dp;
+  if (!deps)
+    return;
+  for (dp = idarraydata + deps; (id = *dp++) != 0; )
+    if (ISRELDEP(id) && !pool->whatprovides_rel[GETRELID(id)])
+      MAPSET(m, GETRELID(id));
+}
+
+void
+pool_createrelproviders(Pool *pool)
+{
+  struct relprovidersworker *workers, *w;
+  Solvable *s;
+  Map m;
+  Queue rels, plist;
+  int *dataend;
+  int i, j, t, nthreads, nstored;
+  Id p, id;
+  unsigned int now;
+
+  POOL_CHECK_THAWED(pool);
+  if (!pool->whatprovides || pool->whatprovidesstale)
+    pool_createwhatprovides(pool);
+  now = sat_timems(0);
+
+  /* the relations we need */
+  map_init(&m, pool->nrels);
+  for (p = 2, s = pool->solvables + p; p < pool->nsolvables; p++, s++)
+    {
+      if (!s->repo)
+	continue;
+      markrelproviders(pool, &m, s->requires, s->repo->idarraydata);
+      markrelproviders(pool, &m, s->conflicts, s->repo->idarraydata);
+      markrelproviders(pool, &m, s->obsoletes, s->repo->idarraydata);
+    }
+  queue_init(&rels);
+  for (id = 1; id < pool->nrels; id++)
+    if (MAPTST(&m, id))
+      queue_push(&rels, id);
+  map_free(&m);
+
+  nthreads = pool->whatprovidesthreads;
+  if (nthreads > rels.count / RELPROVIDERS_PARALLEL_MIN)
+    nthreads = rels.count / RELPROVIDERS_PARALLEL_MIN;
+  if (nthreads < 1)
+    nthreads = 1;
+  dataend = sat_malloc2(rels.count, sizeof(int));
+  workers = sat_calloc(nthreads, sizeof(*workers));
+  for (t = 0; t < nthreads; t++)
+    {
+      w = workers + t;
+      w->pool = pool;
+      w->rels = rels.elements;
+      w->start = (long long)rels.count * t / nthreads;
+      w->end = (long long)rels.count * (t + 1) / nthreads;
+      w->dataend = dataend;
+    }
+  if (nthreads > 1)
+    runworkers(workers, sizeof(*workers), nthreads, relproviders_worker);
+  else
+    for (i = 0; i < rels.count; i++)
+      dataend[i] = -1;
+
+  /* store in relation order */
+  queue_init(&plist);
+  nstored = 0;
+  for (t = 0; t < nthreads; t++)
+    {
+      w = workers + t;
+      for (i = w->start, j = 0; i < w->end; i++)
 	{
-	  Solvable *s = pool->solvables + p;
-	  if (!s->provides)
+	  if (pool->relprovidersmax && pool->relprovidersdata > pool->relprovidersmax)
+	    break;
+	  id = rels.elements[i];
+	  if (dataend[i] < 0)
 	    {
-	      /* no provides - check nevr */
-	      if (pool_match_nevr_rel(pool, s, MAKERELDEP(d)))
-	        queue_push(&plist, p);
+	      if (!pool->whatprovides_rel[id])
+		addrelproviders(pool, MAKERELDEP(id));
+	      nstored++;
 	      continue;
 	    }
-	  /* solvable p provides name in some rels */
-	  pidp = s->repo->idarraydata + s->provides;
-	  while ((pid = *pidp++) != 0)
-	    {
-	      if (pid == name)
-		{
-#if defined(MULTI_SEMANTICS)
-		  if (pool->disttype == DISTTYPE_DEB)
-		    continue;
-		  else
-		    break;
-#elif defined(DEBIAN_SEMANTICS)
-		  continue;		/* unversioned provides can
-				 	 * never match versioned deps */
-#else
-		  break;		/* yes, provides all versions */
-#endif
-		}
-	      if (!ISRELDEP(pid))
-		continue;		/* wrong provides name */
-	      prd = GETRELDEP(pool, pid);
-	      if (prd->name != name)
-		continue;		/* wrong provides name */
-	      /* right package, both deps are rels. check flags/evr */
-	      if (pool_match_flags_evr(pool, prd->flags, prd->evr, flags, evr))
-		break;	/* matches */
-	    }
-	  if (!pid)
-	    continue;	/* none of the providers matched */
-	  queue_push(&plist, p);
+	  queue_empty(&plist);
+	  for (; j < dataend[i]; j++)
+	    queue_push(&plist, w->data[j]);
+	  if (!pool->whatprovides_rel[id])	/* may have been done as part of another relation */
+	    storerelproviders(pool, id, &plist);
+	  nstored++;
 	}
-      /* make our system solvable provide all unknown rpmlib() stuff */
-      if (plist.count == 0 && !strncmp(id2str(pool, name), "rpmlib(", 7))
-	queue_push(&plist, SYSTEMSOLVABLE);
+      sat_free(w->data);
     }
-  /* add providers to whatprovides */
-#if 0
-  POOL_DEBUG(SAT_DEBUG_STATS, "addrelproviders: adding %d packages to %d\n", plist.count, d);
-#endif
-  pool->whatprovides_rel[d] = pool_queuetowhatprovides(pool, &plist);
   queue_free(&plist);
+  sat_free(workers);
+  sat_free(dataend);
+  POOL_DEBUG(SAT_DEBUG_STATS, "created providers of %d of %d relations with %d threads, %d data entries\n", nstored, rels.count, nthreads, pool->relprovidersdata);
+  POOL_DEBUG(SAT_DEBUG_STATS, "createrelproviders took %d ms\n", sat_timems(now));
+  queue_free(&rels);
+}
 
-  return pool->whatprovides_rel[d];
+static void
+fill_languagecache_row(Pool *pool, Id *row, Id keyname)
+{
+  int i;
+  for (i = 0; i < pool->nlanguages; i++)
+    if (!row[i + 1])
+      row[i + 1] = pool_id2langid(pool, keyname, pool->languages[i], 1);
+}
+
+/*
+ * pool_freeze  - make the pool read-only
+ *
+ * create everything that is otherwise computed on demand, so that
+ * solvers can work on the pool from different threads
+ */
+void
+pool_freeze(Pool *pool)
+{
+  static Id langkeys[] = {
+    SOLVABLE_SUMMARY, SOLVABLE_DESCRIPTION, SOLVABLE_EULA,
+    SOLVABLE_MESSAGEINS, SOLVABLE_MESSAGEDEL, SOLVABLE_CATEGORY, 0
+  };
+  Id id, *row;
+  int i, cols;
+
+  if (pool->frozen)
+    return;
+  if (!pool->whatprovides || pool->whatprovidesstale)
+    pool_createwhatprovides(pool);
+  if (pool->evrranks)
+    pool_createevrranks(pool);
+
+  /* providers of all relations */
+  pool_createrelproviders(pool);
+  for (id = 1; id < pool->nrels; id++)
+    if (!pool->whatprovides_rel[id])
+      addrelproviders(pool, MAKERELDEP(id));
+
+  /* reverse dependencies for the cleandeps and supplements code */
+  if (!pool->whatrequires)
+    pool_createwhatrequires(pool);
+
+  /* the lookups rebuild the freed id hashes */
+  pool_str2id(pool, "solvable:name", 0);
+  pool_rel2id(pool, SOLVABLE_NAME, ID_EMPTY, REL_EQ, 0);
+
+  /* fill the language cache for the translated keys and all the keys
+   * that are already cached */
+  if (pool->nlanguages)
+    {
+      cols = pool->nlanguages + 1;
+      if (!pool->languagecache)
+	{
+	  pool->languagecache = sat_calloc(cols * ID_NUM_INTERNAL, sizeof(Id));
+	  pool->languagecacheother = 0;
+	}
+      for (i = 0; langkeys[i]; i++)
+	fill_languagecache_row(pool, pool->languagecache + langkeys[i] * cols, langkeys[i]);
+      row = pool->languagecache + ID_NUM_INTERNAL * cols;
+      for (i = 0; i < pool->languagecacheother; i++, row += cols)
+	fill_languagecache_row(pool, row, row[0]);
+    }
+  pool->frozen = 1;
+}
+
+void
+pool_thaw(Pool *pool)
+{
+  pool->frozen = 0;
 }
 
 /*************************************************************************/
@@ -1062,6 +2061,7 @@ pool_addfileprovides_ids(Pool *pool, Repo *installed, Id **idp)
   int i;
   unsigned int now;
 
+  POOL_CHECK_THAWED(pool);
   now = sat_timems(0);
   memset(&sf, 0, sizeof(sf));
   map_init(&sf.seen, pool->ss.nstrings + pool->nrels);
@@ -1173,6 +2173,7 @@ pool_set_languages(Pool *pool, const char **languages, int nlanguages)
 {
   int i;
 
+  POOL_CHECK_THAWED(pool);
   pool->languagecache = sat_free(pool->languagecache);
   pool->languagecacheother = 0;
   if (pool->nlanguages)
@@ -1211,42 +2212,52 @@ pool_id2langid(Pool *pool, Id id, const char *lang, int create)
   return id;
 }
 
+#ifndef __GNUC__
+#error "frozen pools need thread local storage (__thread)"
+#endif
+/* frozen pools may be used by many threads at once, so they use
+ * a tmpspace per thread */
+static __thread struct _Pool_tmpspace frozentmpspace;
+#define POOL_TMPSPACE(pool) ((pool)->frozen ? &frozentmpspace : &(pool)->tmpspace)
+
 char *
 pool_alloctmpspace(Pool *pool, int len)
 {
-  int n = pool->tmpspace.n;
+  struct _Pool_tmpspace *tmpspace = POOL_TMPSPACE(pool);
+  int n = tmpspace->n;
   if (!len)
     return 0;
-  if (len > pool->tmpspace.len[n])
+  if (len > tmpspace->len[n])
     {
-      pool->tmpspace.buf[n] = sat_realloc(pool->tmpspace.buf[n], len + 32);
-      pool->tmpspace.len[n] = len + 32;
+      tmpspace->buf[n] = sat_realloc(tmpspace->buf[n], len + 32);
+      tmpspace->len[n] = len + 32;
     }
-  pool->tmpspace.n = (n + 1) % POOL_TMPSPACEBUF;
-  return pool->tmpspace.buf[n];
+  tmpspace->n = (n + 1) % POOL_TMPSPACEBUF;
+  return tmpspace->buf[n];
 }
 
 static char *
 pool_alloctmpspace_free(Pool *pool, const char *space, int len)
 {
+  struct _Pool_tmpspace *tmpspace = POOL_TMPSPACE(pool);
   if (space)
     {
       int n, oldn;
-      n = oldn = pool->tmpspace.n;
+      n = oldn = tmpspace->n;
       for (;;)
 	{
 	  if (!n--)
 	    n = POOL_TMPSPACEBUF - 1;
 	  if (n == oldn)
 	    break;
-	  if (pool->tmpspace.buf[n] != space)
+	  if (tmpspace->buf[n] != space)
 	    continue;
-	  if (len > pool->tmpspace.len[n])
+	  if (len > tmpspace->len[n])
 	    {
-	      pool->tmpspace.buf[n] = sat_realloc(pool->tmpspace.buf[n], len + 32);
-	      pool->tmpspace.len[n] = len + 32;
+	      tmpspace->buf[n] = sat_realloc(tmpspace->buf[n], len + 32);
+	      tmpspace->len[n] = len + 32;
 	    }
-          return pool->tmpspace.buf[n];
+          return tmpspace->buf[n];
 	}
     }
   return 0;
@@ -1255,12 +2266,23 @@ pool_alloctmpspace_free(Pool *pool, const char *space, int len)
 void
 pool_freetmpspace(Pool *pool, const char *space)
 {
-  int n = pool->tmpspace.n;
+  struct _Pool_tmpspace *tmpspace = POOL_TMPSPACE(pool);
+  int n = tmpspace->n;
   if (!space)
     return;
   n = (n + (POOL_TMPSPACEBUF - 1)) % POOL_TMPSPACEBUF;
-  if (pool->tmpspace.buf[n] == space)
-    pool->tmpspace.n = n;
+  if (tmpspace->buf[n] == space)
+    tmpspace->n = n;
+}
+
+/* free the tmpspace the calling thread used for frozen pools */
+void
+pool_freetmpspace_thread(void)
+{
+  int i;
+  for (i = 0; i < POOL_TMPSPACEBUF; i++)
+    sat_free(frozentmpspace.buf[i]);
+  memset(&frozentmpspace, 0, sizeof(frozentmpspace));
 }
 
 char *
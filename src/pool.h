@@ -110,6 +110,46 @@ struct _Pool {
   Id *whatprovidesdata;		/* Ids of solvable providing Id */
   Offset whatprovidesdataoff;	/* next free slot within whatprovidesdata */
   int whatprovidesdataleft;	/* number of 'free slots' within whatprovidesdata */
+  int whatprovidesgen;		/* bumped whenever the whatprovides data is freed */
+  int whatprovidesstale;	/* solvables were added or removed, see pool_invalidatewhatprovides() */
+  Map whatprovidesmap;		/* solvables indexed in the whatprovides data */
+  Offset whatprovidesdead;	/* size of the lists updates of the data no longer use */
+  int whatprovidesnstrings;	/* number of ids and relations the data was made for */
+  int whatprovidesnrels;
+  /* number of threads used by pool_createwhatprovides() to create the
+   * data from scratch and by pool_createrelproviders(). The data is the
+   * same as with a single thread.
+   */
+  int whatprovidesthreads;
+
+  /* providers of relations, see pool_createrelproviders()
+   * relprovidersdata is the number of whatprovidesdata entries used by
+   * them. If it is bigger than relprovidersmax (0: no limit), the
+   * next pool_createwhatprovides() call creates the data from scratch,
+   * so the relation providers are computed again on demand.
+   */
+  Offset relprovidersdata;
+  Offset relprovidersmax;
+  unsigned int relprovidersmisses;	/* relation providers computed on demand, not in advance */
+
+  /* reverse dependencies, see pool_createwhatrequires()
+   * whatrequires[3 * p + n] -> Offset into whatrequiresdata
+   * whatrequiresdata[Offset] -> ID_NULL-terminated list of solvables that
+   * require (n = 0), recommend (n = 1) or supplement (n = 2) something p provides
+   */
+  Offset *whatrequires;
+  Id *whatrequiresdata;
+  int nwhatrequires;		/* number of solvables covered by whatrequires */
+
+  /* evr ranks, see pool_createevrranks()
+   * evrranks[2 * evr] -> rank of the evr, 0 if it has none
+   * evrranks[2 * evr + 1] -> rank of epoch:version << 1 | evr has a release
+   * a rank of 0 means that the string compare must be used
+   */
+  Id *evrranks;
+  int nevrranks;		/* number of ids covered by evrranks */
+
+  int frozen;			/* read-only, see pool_freeze() */
 
   /* If nonzero, then consider only the solvables with Ids set in this
      bitmap for solving.  If zero, consider all solvables.  */
@@ -277,9 +317,38 @@ extern void pool_createwhatprovides(Pool *pool);
 extern void pool_addfileprovides(Pool *pool);
 extern void pool_addfileprovides_ids(Pool *pool, struct _Repo *installed, Id **idp);
 extern void pool_freewhatprovides(Pool *pool);
+extern void pool_invalidatewhatprovides(Pool *pool);
 extern Id pool_queuetowhatprovides(Pool *pool, Queue *q);
 
 extern Id pool_addrelproviders(Pool *pool, Id d);
+/* compute the providers of the relations used in requires, conflicts
+ * and obsoletes in advance */
+extern void pool_createrelproviders(Pool *pool);
+
+/**
+ * Reverse dependencies: the solvables that require, recommend or
+ * supplement something a solvable provides. The index is created on
+ * demand and freed together with the whatprovides data.
+ */
+extern void pool_createwhatrequires(Pool *pool);
+extern void pool_freewhatrequires(Pool *pool);
+
+/**
+ * Frozen pools: all lazily computed data (relation providers, the
+ * id hashes, the language cache) is created in pool_freeze(), so that
+ * multiple solvers can work concurrently on the pool. Don't modify the
+ * pool until pool_thaw() is called. Attribute lookups may still load
+ * paged repodata and are not covered.
+ * The strings returned while the pool is frozen (id2str(), dep2str(),
+ * solvid2str(), ...) live in a buffer of the calling thread, not of the
+ * pool. pool_thaw() does not free it, so they stay valid like the other
+ * tmpspace strings. Threads that used a frozen pool should call
+ * pool_freetmpspace_thread() before they exit, this invalidates the
+ * strings.
+ */
+extern void pool_freeze(Pool *pool);
+extern void pool_thaw(Pool *pool);
+extern void pool_freetmpspace_thread(void);
 
 static inline Id pool_whatprovides(Pool *pool, Id d)
 {
@@ -298,6 +367,17 @@ static inline Id *pool_whatprovides_ptr(Pool *pool, Id d)
   return pool->whatprovidesdata + off;
 }
 
+/* keyname is SOLVABLE_REQUIRES, SOLVABLE_RECOMMENDS or SOLVABLE_SUPPLEMENTS */
+static inline Id *pool_whatrequires_ptr(Pool *pool, Id p, Id keyname)
+{
+  if (!pool->whatrequires)
+    pool_createwhatrequires(pool);
+  if (p >= pool->nwhatrequires)
+    return pool->whatrequiresdata;	/* solvable added after the index was created */
+  p = 3 * p + (keyname == SOLVABLE_REQUIRES ? 0 : keyname == SOLVABLE_RECOMMENDS ? 1 : 2);
+  return pool->whatrequiresdata + pool->whatrequires[p];
+}
+
 static inline void pool_setdebugcallback(Pool *pool, void (*debugcallback)(struct _Pool *, void *data, int type, const char *str), void *debugcallbackdata)
 {
   pool->debugcallback = debugcallback;
@@ -358,6 +438,13 @@ void pool_add_fileconflicts_deps(Pool *pool, Queue *conflicts);
     if ((r = pool->repos[idx]) != 0)
     
 
+#ifdef FROZENPOOL_CHECKS
+#include <assert.h>
+#define POOL_CHECK_THAWED(pool) assert(!(pool)->frozen)
+#else
+#define POOL_CHECK_THAWED(pool) do {} while (0)
+#endif
+
 #define POOL_DEBUG(type, ...) do {if ((pool->debugmask & (type)) != 0) pool_debug(pool, (type), __VA_ARGS__);} while (0)
 #define IF_POOLDEBUG(type) if ((pool->debugmask & (type)) != 0)
 
@@ -56,6 +56,7 @@ static const char *archpolicies[] = {
 void
 pool_setarch(Pool *pool, const char *arch)
 {
+  POOL_CHECK_THAWED(pool);
   if (arch)
     {
       int i;
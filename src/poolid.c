@@ -28,6 +28,8 @@ pool_str2id(Pool *pool, const char *str, int create)
 {
   int oldnstrings = pool->ss.nstrings;
   Id id = stringpool_str2id(&pool->ss, str, create);
+  if (create && oldnstrings != pool->ss.nstrings)
+    POOL_CHECK_THAWED(pool);
   if (create && pool->whatprovides && oldnstrings != pool->ss.nstrings && (id & WHATPROVIDES_BLOCK) == 0)
     {
       /* grow whatprovides array */
@@ -42,6 +44,8 @@ pool_strn2id(Pool *pool, const char *str, unsigned int len, int create)
 {
   int oldnstrings = pool->ss.nstrings;
   Id id = stringpool_strn2id(&pool->ss, str, len, create);
+  if (create && oldnstrings != pool->ss.nstrings)
+    POOL_CHECK_THAWED(pool);
   if (create && pool->whatprovides && oldnstrings != pool->ss.nstrings && (id & WHATPROVIDES_BLOCK) == 0)
     {
       /* grow whatprovides array */
@@ -98,6 +102,7 @@ pool_rel2id(Pool *pool, Id name, Id evr, int flags, int create)
   if (!create)
     return ID_NULL;
 
+  POOL_CHECK_THAWED(pool);
   id = pool->nrels++;
   /* extend rel space if needed */
   pool->rels = sat_extend(pool->rels, id, 1, sizeof(Reldep), REL_BLOCK);
@@ -283,6 +288,7 @@ pool_shrink_rels(Pool *pool)
 void
 pool_freeidhashes(Pool *pool)
 {
+  POOL_CHECK_THAWED(pool);
   stringpool_freehash(&pool->ss);
   pool->relhashtbl = sat_free(pool->relhashtbl);
   pool->relhashmask = 0;
@@ -85,6 +85,7 @@ pool_setvendorclasses(Pool *pool, const char **vendorclasses)
   int i;
   const char **v;
 
+  POOL_CHECK_THAWED(pool);
   if (pool->vendorclasses)
     {
       for (v = pool->vendorclasses; v[0] || v[1]; v++)
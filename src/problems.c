@@ -181,6 +181,7 @@ refine_suggestion(Solver *solv, Id *problem, Id sug, Queue *refined, int essenti
   Id v;
   Queue disabled;
   int disabledcnt;
+  size_t scratchmark;
 
   IF_POOLDEBUG (SAT_DEBUG_SOLUTIONS)
     {
@@ -195,7 +196,8 @@ refine_suggestion(Solver *solv, Id *problem, Id sug, Queue *refined, int essenti
   queue_empty(refined);
   if (!essentialok && sug < 0 && (solv->job.elements[-sug - 1] & SOLVER_ESSENTIAL) != 0)
     return;
-  queue_init(&disabled);
+  scratchmark = scratch_mark(&solv->scratch);
+  scratch_queue_init(&solv->scratch, &disabled, 64);
   queue_push(refined, sug);
 
   /* re-enable all problem rules with the exception of "sug"(gestion) */
@@ -226,6 +228,12 @@ refine_suggestion(Solver *solv, Id *problem, Id sug, Queue *refined, int essenti
       if (!solv->problems.count)
         solver_run_sat(solv, 0, 0);
 
+      if (solv->budget_exhausted)
+	{
+	  refined->count = 0;	/* we don't know if this is a solution */
+	  break;
+	}
+
       if (!solv->problems.count)
 	{
 	  POOL_DEBUG(SAT_DEBUG_SOLUTIONS, "no more problems!\n");
@@ -287,7 +295,7 @@ refine_suggestion(Solver *solv, Id *problem, Id sug, Queue *refined, int essenti
 	      if (v < solv->featurerules || v >= solv->featurerules_end)
 	        disabled.elements[j++] = v;
 	    }
-	  disabled.count = j;
+	  queue_truncate(&disabled, j);
 	  nfeature = 0;
 	}
       if (disabled.count == disabledcnt + 1)
@@ -336,6 +344,7 @@ refine_suggestion(Solver *solv, Id *problem, Id sug, Queue *refined, int essenti
   for (i = 0; i < disabled.count; i++)
     solver_enableproblem(solv, disabled.elements[i]);
   queue_free(&disabled);
+  scratch_release(&solv->scratch, scratchmark);
   /* reset policy rules */
   for (i = 0; problem[i]; i++)
     solver_enableproblem(solv, problem[i]);
@@ -522,16 +531,18 @@ create_solutions(Solver *solv, int probnr, int solidx)
 {
   Pool *pool = solv->pool;
   Queue redoq;
-  Queue problem, solution, problems_save;
+  Queue problem, solution, problems_save, recommendations_save;
   int i, j, nsol;
   int essentialok;
-  int recocount;
   unsigned int now;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
   now = sat_timems(0);
-  recocount = solv->recommendations.count;
-  solv->recommendations.count = 0;	/* so that revert() doesn't mess with it later */
-  queue_init(&redoq);
+  solver_startbudget(solv);
+  /* save recommendations queue, so that revert() doesn't mess with it later */
+  recommendations_save = solv->recommendations;
+  memset(&solv->recommendations, 0, sizeof(solv->recommendations));
+  scratch_queue_init(&solv->scratch, &redoq, 3 * solv->decisionq.count);
   /* save decisionq, decisionq_why, decisionmap */
   for (i = 0; i < solv->decisionq.count; i++)
     {
@@ -545,7 +556,7 @@ create_solutions(Solver *solv, int probnr, int solidx)
   memset(&solv->problems, 0, sizeof(solv->problems));
 
   /* extract problem from queue */
-  queue_init(&problem);
+  scratch_queue_init(&solv->scratch, &problem, 64);
   for (i = solidx + 1; i < solv->solutions.count; i++)
     {
       Id v = solv->solutions.elements[i];
@@ -565,11 +576,13 @@ create_solutions(Solver *solv, int probnr, int solidx)
   /* refine each solution element */
   nsol = 0;
   essentialok = 0;
-  queue_init(&solution);
+  scratch_queue_init(&solv->scratch, &solution, 64);
   for (i = 0; i < problem.count; i++)
     {
       int solstart = solv->solutions.count;
       refine_suggestion(solv, problem.elements, problem.elements[i], &solution, essentialok);
+      if (solv->budget_exhausted)
+	break;			/* out of budget, keep what we have */
       queue_push(&solv->solutions, 0);	/* reserve room for number of elements */
       for (j = 0; j < solution.count; j++)
 	convertsolution(solv, solution.elements[j], &solv->solutions);
@@ -624,8 +637,11 @@ create_solutions(Solver *solv, int probnr, int solidx)
       queue_push(&solv->decisionq_why, redoq.elements[i + 1]);
       solv->decisionmap[p > 0 ? p : -p] = redoq.elements[i + 2];
     }
-  solv->recommendations.count = recocount;
+  solv->recommends_index = -1;
+  queue_free(&solv->recommendations);
+  solv->recommendations = recommendations_save;
   queue_free(&redoq);
+  scratch_release(&solv->scratch, scratchmark);
   /* restore problems */
   queue_free(&solv->problems);
   solv->problems = problems_save;
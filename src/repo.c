@@ -40,7 +40,7 @@ repo_create(Pool *pool, const char *name)
 {
   Repo *repo;
 
-  pool_freewhatprovides(pool);
+  pool_invalidatewhatprovides(pool);
   repo = (Repo *)sat_calloc(1, sizeof(*repo));
   pool->repos = (Repo **)sat_realloc2(pool->repos, pool->nrepos + 1, sizeof(Repo *));
   pool->repos[pool->nrepos++] = repo;
@@ -75,7 +75,7 @@ repo_empty(Repo *repo, int reuseids)
   Solvable *s;
   int i;
 
-  pool_freewhatprovides(pool);
+  pool_invalidatewhatprovides(pool);
   if (reuseids && repo->end == pool->nsolvables)
     {
       /* it's ok to reuse the ids. As this is the last repo, we can
@@ -95,6 +95,7 @@ repo_empty(Repo *repo, int reuseids)
   repo->idarraydata = sat_free(repo->idarraydata);
   repo->idarraysize = 0;
   repo->lastoff = 0;
+  repo->whatprovidessize = -1;	/* all new data */
   repo->rpmdbid = sat_free(repo->rpmdbid);
   for (i = 0; i < repo->nrepodata; i++)
     repodata_freedata(repo->repodata + i);
@@ -114,6 +115,7 @@ repo_free(Repo *repo, int reuseids)
   Pool *pool = repo->pool;
   int i;
 
+  POOL_CHECK_THAWED(pool);
   if (repo == pool->installed)
     pool->installed = 0;
   repo_empty(repo, reuseids);
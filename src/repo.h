@@ -37,6 +37,7 @@ typedef struct _Repo {
   Id *idarraydata;		/* array of metadata Ids, solvable dependencies are offsets into this array */
   int idarraysize;
   Offset lastoff;		/* start of last array in idarraydata */
+  int whatprovidessize;		/* idarraysize when the whatprovides data was created */
 
   Id *rpmdbid;			/* solvable side data */
 
@@ -2786,6 +2786,7 @@ repodata_load_stub(Repodata *data)
       data->state = REPODATA_ERROR;
       return;
     }
+  POOL_CHECK_THAWED(pool);
   data->state = REPODATA_LOADING;
 
   /* save tmp space */
@@ -16,6 +16,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "solver.h"
 #include "bitmap.h"
@@ -85,7 +86,7 @@ dep_possible(Solver *solv, Id dep, Map *m)
 static int
 unifyrules_sortcmp(const void *ap, const void *bp, void *dp)
 {
-  Pool *pool = dp;
+  Solver *solv = dp;
   Rule *a = (Rule *)ap;
   Rule *b = (Rule *)bp;
   Id *ad, *bd;
@@ -101,19 +102,19 @@ unifyrules_sortcmp(const void *ap, const void *bp, void *dp)
 
   if (a->d == 0)		       /* a is assertion, b not */
     {
-      x = a->w2 - pool->whatprovidesdata[b->d];
+      x = a->w2 - *solver_whatprovidesdata(solv, b->d);
       return x ? x : -1;
     }
 
   if (b->d == 0)		       /* b is assertion, a not */
     {
-      x = pool->whatprovidesdata[a->d] - b->w2;
+      x = *solver_whatprovidesdata(solv, a->d) - b->w2;
       return x ? x : 1;
     }
 
   /* compare whatprovidesdata */
-  ad = pool->whatprovidesdata + a->d;
-  bd = pool->whatprovidesdata + b->d;
+  ad = solver_whatprovidesdata(solv, a->d);
+  bd = solver_whatprovidesdata(solv, b->d);
   while (*bd)
     if ((x = *ad++ - *bd++) != 0)
       return x;
@@ -123,7 +124,7 @@ unifyrules_sortcmp(const void *ap, const void *bp, void *dp)
 int
 solver_samerule(Solver *solv, Rule *r1, Rule *r2)
 {
-  return unifyrules_sortcmp(r1, r2, solv->pool);
+  return unifyrules_sortcmp(r1, r2, solv);
 }
 
 
@@ -146,7 +147,7 @@ solver_unifyrules(Solver *solv)
   POOL_DEBUG(SAT_DEBUG_SCHUBI, "----- unifyrules -----\n");
 
   /* sort rules first */
-  sat_sort(solv->rules + 1, solv->nrules - 1, sizeof(Rule), unifyrules_sortcmp, solv->pool);
+  sat_sort(solv->rules + 1, solv->nrules - 1, sizeof(Rule), unifyrules_sortcmp, solv);
 
   /* prune rules
    * i = unpruned
@@ -155,7 +156,7 @@ solver_unifyrules(Solver *solv)
   jr = 0;
   for (i = j = 1, ir = solv->rules + i; i < solv->nrules; i++, ir++)
     {
-      if (jr && !unifyrules_sortcmp(ir, jr, pool))
+      if (jr && !unifyrules_sortcmp(ir, jr, solv))
 	continue;		       /* prune! */
       jr = solv->rules + j++;	       /* keep! */
       if (ir != jr)
@@ -186,7 +187,7 @@ solver_unifyrules(Solver *solv)
 	    binr++;
 	  else
 	    {
-	      dp = solv->pool->whatprovidesdata + r->d;
+	      dp = solver_whatprovidesdata(solv, r->d);
 	      while (*dp++)
 		lits++;
 	    }
@@ -211,7 +212,7 @@ hashrule(Solver *solv, Id p, Id d, int n)
 
   if (n <= 1)
     return (x * 37) ^ (unsigned int)d;
-  dp = solv->pool->whatprovidesdata + d;
+  dp = solver_whatprovidesdata(solv, d);
   while (*dp)
     x = (x * 37) ^ (unsigned int)*dp++;
   return x;
@@ -254,7 +255,7 @@ hashrule(Solver *solv, Id p, Id d, int n)
  *   Direct assertion (no watch needed) --> d = 0, w1 = p, w2 = 0
  *   Binary rule: p = first literal, d = 0, w2 = second literal, w1 = p
  *   every other : w1 = p, w2 = whatprovidesdata[d];
- *   Disabled rule: w1 = 0
+ *   Deleted learnt rule: w1 = w2 = 0 (see reducelearntrules)
  *
  *   always returns a rule for non-rpm rules
  */
@@ -296,7 +297,7 @@ solver_addrule(Solver *solv, Id p, Id d)
     }
   else if (d > 0)
     {
-      for (dp = pool->whatprovidesdata + d; *dp; dp++, n++)
+      for (dp = solver_whatprovidesdata(solv, d); *dp; dp++, n++)
 	if (*dp == -p)
 	  return 0;			/* rule is self-fulfilling */
 	
@@ -326,8 +327,8 @@ solver_addrule(Solver *solv, Id p, Id d)
       Id *dp2;
       if (d == r->d)
 	return r;
-      dp2 = pool->whatprovidesdata + r->d;
-      for (dp = pool->whatprovidesdata + d; *dp; dp++, dp2++)
+      dp2 = solver_whatprovidesdata(solv, r->d);
+      for (dp = solver_whatprovidesdata(solv, d); *dp; dp++, dp2++)
 	if (*dp != *dp2)
 	  break;
       if (*dp == *dp2)
@@ -365,10 +366,8 @@ solver_addrule(Solver *solv, Id p, Id d)
     {
       r->d = d;
       r->w1 = p;
-      r->w2 = pool->whatprovidesdata[d];
+      r->w2 = *solver_whatprovidesdata(solv, d);
     }
-  r->n1 = 0;
-  r->n2 = 0;
 
   IF_POOLDEBUG (SAT_DEBUG_RULE_CREATION)
     {
@@ -419,7 +418,7 @@ makemultiversionconflict(Solver *solv, Id n, Id con)
     }
   if (q.count == 1)
     return -n;	/* no other package found, generate normal conflict */
-  return pool_queuetowhatprovides(pool, &q);
+  return solver_queuetowhatprovides(solv, &q);
 }
 
 static inline void
@@ -431,37 +430,29 @@ addrpmrule(Solver *solv, Id p, Id d, int type, Id dep)
     addrpmruleinfo(solv, p, d, type, dep);
 }
 
-/*-------------------------------------------------------------------
- * 
- * add (install) rules for solvable
- * 
- * s: Solvable for which to add rules
- * m: m[s] = 1 for solvables which have rules, prevent rule duplication
- * 
- * Algorithm: 'visit all nodes of a graph'. The graph nodes are
- *  solvables, the edges their dependencies.
- *  Starting from an installed solvable, this will create all rules
- *  representing the graph created by the solvables dependencies.
- * 
- * for unfulfilled requirements, conflicts, obsoletes,....
- * add a negative assertion for solvables that are not installable
- * 
- * It will also create rules for all solvables referenced by 's'
- *  i.e. descend to all providers of requirements of 's'
- *
+static inline void
+addrpmrule_q(Solver *solv, Queue *ruleq, Id p, Id d, int type, Id dep)
+{
+  if (ruleq)
+    queue_push2(ruleq, p, d);	/* added later by the merge */
+  else
+    addrpmrule(solv, p, d, type, dep);
+}
+
+/*
+ * add the rpm rules of solvable n and push the providers of
+ * its dependencies on the work queue.
+ * If ruleq is set, the rules are recorded instead of added, this
+ * is used by the worker threads. Returns 0 if the solvable
+ * must be done by the calling thread.
  */
 
-void
-solver_addrpmrulesforsolvable(Solver *solv, Solvable *s, Map *m)
+static int
+addrpmrulesforsolvable_one(Solver *solv, Id n, Map *m, Queue *workq, Queue *ruleq)
 {
   Pool *pool = solv->pool;
   Repo *installed = solv->installed;
-
-  /* 'work' queue. keeps Ids of solvables we still have to work on.
-     And buffer for it. */
-  Queue workq;
-  Id workqbuf[64];
-    
+  Solvable *s;
   int i;
     /* if to add rules for broken deps ('rpm -V' functionality)
      * 0 = yes, 1 = no
@@ -477,279 +468,457 @@ solver_addrpmrulesforsolvable(Solver *solv, Solvable *s, Map *m)
   Id sug, *sugp;
   Id p, pp;		/* whatprovides loops */
   Id *dp;		/* ptr to 'whatprovides' */
-  Id n;			/* Id for current solvable 's' */
 
-  POOL_DEBUG(SAT_DEBUG_SCHUBI, "----- addrpmrulesforsolvable -----\n");
+  s = pool->solvables + n;          /* s = Solvable in question */
 
-  queue_init_buffer(&workq, workqbuf, sizeof(workqbuf)/sizeof(*workqbuf));
-  queue_push(&workq, s - pool->solvables);	/* push solvable Id to work queue */
+  dontfix = 0;
+  if (installed                     /* Installed system available */
+      && s->repo == installed       /* solvable is installed */
+      && !solv->fixmap_all          /* NOT repair errors in rpm dependency graph */
+      && !(solv->fixmap.size && MAPTST(&solv->fixmap, n - installed->start)))
+    {
+      dontfix = 1;                  /* dont care about broken rpm deps */
+    }
 
-  /* loop until there's no more work left */
-  while (workq.count)
+  if (!dontfix
+      && s->arch != ARCH_SRC
+      && s->arch != ARCH_NOSRC
+      && !pool_installable(pool, s))
     {
-      /*
-       * n: Id of solvable
-       * s: Pointer to solvable
-       */
+      POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "package %s [%d] is not installable\n", solvable2str(pool, s), (Id)(s - pool->solvables));
+      addrpmrule_q(solv, ruleq, -n, 0, SOLVER_RULE_RPM_NOT_INSTALLABLE, 0);
+    }
 
-      n = queue_shift(&workq);		/* 'pop' next solvable to work on from queue */
-      if (m)
+  /* yet another SUSE hack, sigh */
+  if (pool->nscallback && !strncmp("product:", id2str(pool, s->name), 8))
+    {
+      Id buddy;
+      if (ruleq)
+	return 0;		/* don't call back from a worker thread */
+      buddy = pool->nscallback(pool, pool->nscallbackdata, NAMESPACE_PRODUCTBUDDY, n);
+      if (buddy > 0 && buddy != SYSTEMSOLVABLE && buddy != n && buddy < pool->nsolvables)
 	{
-	  if (MAPTST(m, n))		/* continue if already visited */
-	    continue;
-	  MAPSET(m, n);			/* mark as visited */
+	  addrpmrule_q(solv, ruleq, n, -buddy, SOLVER_RULE_RPM_PACKAGE_REQUIRES, solvable_selfprovidedep(pool->solvables + n));
+	  addrpmrule_q(solv, ruleq, buddy, -n, SOLVER_RULE_RPM_PACKAGE_REQUIRES, solvable_selfprovidedep(pool->solvables + buddy)); 
+	  if (m && !MAPTST(m, buddy))
+	    queue_push(workq, buddy);
 	}
+    }
 
-      s = pool->solvables + n;		/* s = Solvable in question */
-
-      dontfix = 0;
-      if (installed			/* Installed system available */
-	  && s->repo == installed	/* solvable is installed */
-	  && !solv->fixmap_all		/* NOT repair errors in rpm dependency graph */
-	  && !(solv->fixmap.size && MAPTST(&solv->fixmap, n - installed->start)))
-        {
-	  dontfix = 1;			/* dont care about broken rpm deps */
-        }
+  /*-----------------------------------------
+   * check requires of s
+   */
 
-      if (!dontfix
-	  && s->arch != ARCH_SRC
-	  && s->arch != ARCH_NOSRC
-	  && !pool_installable(pool, s))
+  if (s->requires)
+    {
+      reqp = s->repo->idarraydata + s->requires;
+      while ((req = *reqp++) != 0)            /* go through all requires */
 	{
-	  POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "package %s [%d] is not installable\n", solvable2str(pool, s), (Id)(s - pool->solvables));
-	  addrpmrule(solv, -n, 0, SOLVER_RULE_RPM_NOT_INSTALLABLE, 0);
-	}
+	  if (req == SOLVABLE_PREREQMARKER)   /* skip the marker */
+	    continue;
 
-      /* yet another SUSE hack, sigh */
-      if (pool->nscallback && !strncmp("product:", id2str(pool, s->name), 8))
-        {
-          Id buddy = pool->nscallback(pool, pool->nscallbackdata, NAMESPACE_PRODUCTBUDDY, n);
-          if (buddy > 0 && buddy != SYSTEMSOLVABLE && buddy != n && buddy < pool->nsolvables)
-            {
-              addrpmrule(solv, n, -buddy, SOLVER_RULE_RPM_PACKAGE_REQUIRES, solvable_selfprovidedep(pool->solvables + n));
-              addrpmrule(solv, buddy, -n, SOLVER_RULE_RPM_PACKAGE_REQUIRES, solvable_selfprovidedep(pool->solvables + buddy)); 
-	      if (m && !MAPTST(m, buddy))
-		queue_push(&workq, buddy);
-            }
-        }
+	  /* find list of solvables providing 'req' */
+	  dp = pool_whatprovides_ptr(pool, req);
 
-      /*-----------------------------------------
-       * check requires of s
-       */
+	  if (*dp == SYSTEMSOLVABLE)          /* always installed */
+	    continue;
 
-      if (s->requires)
-	{
-	  reqp = s->repo->idarraydata + s->requires;
-	  while ((req = *reqp++) != 0)            /* go through all requires */
+	  if (dontfix)
 	    {
-	      if (req == SOLVABLE_PREREQMARKER)   /* skip the marker */
-		continue;
+	      /* the strategy here is to not insist on dependencies
+	       * that are already broken. so if we find one provider
+	       * that was already installed, we know that the
+	       * dependency was not broken before so we enforce it */
 
-	      /* find list of solvables providing 'req' */
-	      dp = pool_whatprovides_ptr(pool, req);
-
-	      if (*dp == SYSTEMSOLVABLE)	  /* always installed */
-		continue;
-
-	      if (dontfix)
+	      /* check if any of the providers for 'req' is installed */
+	      for (i = 0; (p = dp[i]) != 0; i++)
 		{
-		  /* the strategy here is to not insist on dependencies
-                   * that are already broken. so if we find one provider
-                   * that was already installed, we know that the
-                   * dependency was not broken before so we enforce it */
-		 
-		  /* check if any of the providers for 'req' is installed */
-		  for (i = 0; (p = dp[i]) != 0; i++)
-		    {
-		      if (pool->solvables[p].repo == installed)
-			break;		/* provider was installed */
-		    }
-		  /* didn't find an installed provider: previously broken dependency */
-		  if (!p)
-		    {
-		      POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "ignoring broken requires %s of installed package %s\n", dep2str(pool, req), solvable2str(pool, s));
-		      continue;
-		    }
+		  if (pool->solvables[p].repo == installed)
+		    break;          /* provider was installed */
 		}
-
-	      if (!*dp)
+	      /* didn't find an installed provider: previously broken dependency */
+	      if (!p)
 		{
-		  /* nothing provides req! */
-		  POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "package %s [%d] is not installable (%s)\n", solvable2str(pool, s), (Id)(s - pool->solvables), dep2str(pool, req));
-		  addrpmrule(solv, -n, 0, SOLVER_RULE_RPM_NOTHING_PROVIDES_DEP, req);
+		  POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "ignoring broken requires %s of installed package %s\n", dep2str(pool, req), solvable2str(pool, s));
 		  continue;
 		}
+	    }
 
-	      IF_POOLDEBUG (SAT_DEBUG_RULE_CREATION)
-	        {
-		  POOL_DEBUG(SAT_DEBUG_RULE_CREATION,"  %s requires %s\n", solvable2str(pool, s), dep2str(pool, req));
-		  for (i = 0; dp[i]; i++)
-		    POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "   provided by %s\n", solvid2str(pool, dp[i]));
-	        }
+	  if (!*dp)
+	    {
+	      /* nothing provides req! */
+	      POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "package %s [%d] is not installable (%s)\n", solvable2str(pool, s), (Id)(s - pool->solvables), dep2str(pool, req));
+	      addrpmrule_q(solv, ruleq, -n, 0, SOLVER_RULE_RPM_NOTHING_PROVIDES_DEP, req);
+	      continue;
+	    }
+
+	  IF_POOLDEBUG (SAT_DEBUG_RULE_CREATION)
+	    {
+	      POOL_DEBUG(SAT_DEBUG_RULE_CREATION,"  %s requires %s\n", solvable2str(pool, s), dep2str(pool, req));
+	      for (i = 0; dp[i]; i++)
+		POOL_DEBUG(SAT_DEBUG_RULE_CREATION, "   provided by %s\n", solvid2str(pool, dp[i]));
+	    }
 
-	      /* add 'requires' dependency */
-              /* rule: (-requestor|provider1|provider2|...|providerN) */
-	      addrpmrule(solv, -n, dp - pool->whatprovidesdata, SOLVER_RULE_RPM_PACKAGE_REQUIRES, req);
+	  /* add 'requires' dependency */
+	  /* rule: (-requestor|provider1|provider2|...|providerN) */
+	  addrpmrule_q(solv, ruleq, -n, dp - pool->whatprovidesdata, SOLVER_RULE_RPM_PACKAGE_REQUIRES, req);
 
-	      /* descend the dependency tree
-	         push all non-visited providers on the work queue */
-	      if (m)
+	  /* descend the dependency tree
+	     push all non-visited providers on the work queue */
+	  if (m)
+	    {
+	      for (; *dp; dp++)
 		{
-		  for (; *dp; dp++)
-		    {
-		      if (!MAPTST(m, *dp))
-			queue_push(&workq, *dp);
-		    }
+		  if (!MAPTST(m, *dp))
+		    queue_push(workq, *dp);
 		}
+	    }
 
-	    } /* while, requirements of n */
+	} /* while, requirements of n */
 
-	} /* if, requirements */
+    } /* if, requirements */
 
-      /* that's all we check for src packages */
-      if (s->arch == ARCH_SRC || s->arch == ARCH_NOSRC)
-	continue;
+  /* that's all we check for src packages */
+  if (s->arch == ARCH_SRC || s->arch == ARCH_NOSRC)
+    return 1;
 
-      /*-----------------------------------------
-       * check conflicts of s
-       */
+  /*-----------------------------------------
+   * check conflicts of s
+   */
 
-      if (s->conflicts)
-	{
-	  int ispatch = 0;
-
-	  /* we treat conflicts in patches a bit differen:
-	   * - nevr matching
-	   * - multiversion handling
-	   * XXX: we should really handle this different, looking
-	   * at the name is a bad hack
-	   */
-	  if (!strncmp("patch:", id2str(pool, s->name), 6))
-	    ispatch = 1;
-	  conp = s->repo->idarraydata + s->conflicts;
-	  /* foreach conflicts of 's' */
-	  while ((con = *conp++) != 0)
-	    {
-	      /* foreach providers of a conflict of 's' */
-	      FOR_PROVIDES(p, pp, con)
-		{
-		  if (ispatch && !pool_match_nevr(pool, pool->solvables + p, con))
-		    continue;
-		  /* dontfix: dont care about conflicts with already installed packs */
-		  if (dontfix && pool->solvables[p].repo == installed)
-		    continue;
-		  /* p == n: self conflict */
-		  if (p == n && !pool->allowselfconflicts)
-		    {
-		      if (ISRELDEP(con))
-			{
-			  Reldep *rd = GETRELDEP(pool, con);
-			  if (rd->flags == REL_NAMESPACE && rd->name == NAMESPACE_OTHERPROVIDERS)
-			    continue;
-			}
-		      p = 0;	/* make it a negative assertion, aka 'uninstallable' */
-		    }
-		  if (p && ispatch && solv->noobsoletes.size && MAPTST(&solv->noobsoletes, p) && ISRELDEP(con))
-		    {
-		      /* our patch conflicts with a noobsoletes (aka multiversion) package */
-		      p = -makemultiversionconflict(solv, p, con);
-		    }
-                 /* rule: -n|-p: either solvable _or_ provider of conflict */
-		  addrpmrule(solv, -n, -p, p ? SOLVER_RULE_RPM_PACKAGE_CONFLICT : SOLVER_RULE_RPM_SELF_CONFLICT, con);
-		}
-	    }
-	}
+  if (s->conflicts)
+    {
+      int ispatch = 0;
 
-      /*-----------------------------------------
-       * check obsoletes and implicit obsoletes of a package
-       * if ignoreinstalledsobsoletes is not set, we're also checking
-       * obsoletes of installed packages (like newer rpm versions)
+      /* we treat conflicts in patches a bit differen:
+       * - nevr matching
+       * - multiversion handling
+       * XXX: we should really handle this different, looking
+       * at the name is a bad hack
        */
-      if ((!installed || s->repo != installed) || !pool->noinstalledobsoletes)
+      if (!strncmp("patch:", id2str(pool, s->name), 6))
+	ispatch = 1;
+      conp = s->repo->idarraydata + s->conflicts;
+      /* foreach conflicts of 's' */
+      while ((con = *conp++) != 0)
 	{
-	  int noobs = solv->noobsoletes.size && MAPTST(&solv->noobsoletes, n);
-	  int isinstalled = (installed && s->repo == installed);
-	  if (s->obsoletes && !noobs)
+	  /* foreach providers of a conflict of 's' */
+	  FOR_PROVIDES(p, pp, con)
 	    {
-	      obsp = s->repo->idarraydata + s->obsoletes;
-	      /* foreach obsoletes */
-	      while ((obs = *obsp++) != 0)
+	      if (ispatch && !pool_match_nevr(pool, pool->solvables + p, con))
+		continue;
+	      /* dontfix: dont care about conflicts with already installed packs */
+	      if (dontfix && pool->solvables[p].repo == installed)
+		continue;
+	      /* p == n: self conflict */
+	      if (p == n && !pool->allowselfconflicts)
 		{
-		  /* foreach provider of an obsoletes of 's' */ 
-		  FOR_PROVIDES(p, pp, obs)
+		  if (ISRELDEP(con))
 		    {
-		      Solvable *ps = pool->solvables + p;
-		      if (p == n)
+		      Reldep *rd = GETRELDEP(pool, con);
+		      if (rd->flags == REL_NAMESPACE && rd->name == NAMESPACE_OTHERPROVIDERS)
 			continue;
-		      if (isinstalled && dontfix && ps->repo == installed)
-			continue;	/* don't repair installed/installed problems */
-		      if (!pool->obsoleteusesprovides /* obsoletes are matched names, not provides */
-			  && !pool_match_nevr(pool, ps, obs))
-			continue;
-		      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, ps))
-			continue;
-		      if (!isinstalled)
-			addrpmrule(solv, -n, -p, SOLVER_RULE_RPM_PACKAGE_OBSOLETES, obs);
-		      else
-			addrpmrule(solv, -n, -p, SOLVER_RULE_RPM_INSTALLEDPKG_OBSOLETES, obs);
 		    }
+		  p = 0;    /* make it a negative assertion, aka 'uninstallable' */
+		}
+	      if (p && ispatch && solv->noobsoletes.size && MAPTST(&solv->noobsoletes, p) && ISRELDEP(con))
+		{
+		  /* our patch conflicts with a noobsoletes (aka multiversion) package */
+		  if (ruleq)
+		    return 0;	/* may add to the solver's whatprovides data */
+		  p = -makemultiversionconflict(solv, p, con);
 		}
+	     /* rule: -n|-p: either solvable _or_ provider of conflict */
+	      addrpmrule_q(solv, ruleq, -n, -p, p ? SOLVER_RULE_RPM_PACKAGE_CONFLICT : SOLVER_RULE_RPM_SELF_CONFLICT, con);
 	    }
-	  /* check implicit obsoletes
-           * for installed packages we only need to check installed/installed problems (and
-           * only when dontfix is not set), as the others are picked up when looking at the
-           * uninstalled package.
-           */
-	  if (!isinstalled || !dontfix)
+	}
+    }
+
+  /*-----------------------------------------
+   * check obsoletes and implicit obsoletes of a package
+   * if ignoreinstalledsobsoletes is not set, we're also checking
+   * obsoletes of installed packages (like newer rpm versions)
+   */
+  if ((!installed || s->repo != installed) || !pool->noinstalledobsoletes)
+    {
+      int noobs = solv->noobsoletes.size && MAPTST(&solv->noobsoletes, n);
+      int isinstalled = (installed && s->repo == installed);
+      if (s->obsoletes && !noobs)
+	{
+	  obsp = s->repo->idarraydata + s->obsoletes;
+	  /* foreach obsoletes */
+	  while ((obs = *obsp++) != 0)
 	    {
-	      FOR_PROVIDES(p, pp, s->name)
+	      /* foreach provider of an obsoletes of 's' */ 
+	      FOR_PROVIDES(p, pp, obs)
 		{
 		  Solvable *ps = pool->solvables + p;
 		  if (p == n)
 		    continue;
-		  if (isinstalled && ps->repo != installed)
-		    continue;
-		  /* we still obsolete packages with same nevra, like rpm does */
-		  /* (actually, rpm mixes those packages. yuck...) */
-		  if (noobs && (s->name != ps->name || s->evr != ps->evr || s->arch != ps->arch))
-		    continue;
-		  if (!pool->implicitobsoleteusesprovides && s->name != ps->name)
+		  if (isinstalled && dontfix && ps->repo == installed)
+		    continue;       /* don't repair installed/installed problems */
+		  if (!pool->obsoleteusesprovides /* obsoletes are matched names, not provides */
+		      && !pool_match_nevr(pool, ps, obs))
 		    continue;
 		  if (pool->obsoleteusescolors && !pool_colormatch(pool, s, ps))
 		    continue;
-		  if (s->name == ps->name)
-		    addrpmrule(solv, -n, -p, SOLVER_RULE_RPM_SAME_NAME, 0);
+		  if (!isinstalled)
+		    addrpmrule_q(solv, ruleq, -n, -p, SOLVER_RULE_RPM_PACKAGE_OBSOLETES, obs);
 		  else
-		    addrpmrule(solv, -n, -p, SOLVER_RULE_RPM_IMPLICIT_OBSOLETES, s->name);
+		    addrpmrule_q(solv, ruleq, -n, -p, SOLVER_RULE_RPM_INSTALLEDPKG_OBSOLETES, obs);
 		}
 	    }
 	}
-
-      /*-----------------------------------------
-       * add recommends to the work queue
+      /* check implicit obsoletes
+       * for installed packages we only need to check installed/installed problems (and
+       * only when dontfix is not set), as the others are picked up when looking at the
+       * uninstalled package.
        */
-      if (s->recommends && m)
+      if (!isinstalled || !dontfix)
 	{
-	  recp = s->repo->idarraydata + s->recommends;
-	  while ((rec = *recp++) != 0)
+	  FOR_PROVIDES(p, pp, s->name)
 	    {
-	      FOR_PROVIDES(p, pp, rec)
-		if (!MAPTST(m, p))
-		  queue_push(&workq, p);
+	      Solvable *ps = pool->solvables + p;
+	      if (p == n)
+		continue;
+	      if (isinstalled && ps->repo != installed)
+		continue;
+	      /* we still obsolete packages with same nevra, like rpm does */
+	      /* (actually, rpm mixes those packages. yuck...) */
+	      if (noobs && (s->name != ps->name || s->evr != ps->evr || s->arch != ps->arch))
+		continue;
+	      if (!pool->implicitobsoleteusesprovides && s->name != ps->name)
+		continue;
+	      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, ps))
+		continue;
+	      if (s->name == ps->name)
+		addrpmrule_q(solv, ruleq, -n, -p, SOLVER_RULE_RPM_SAME_NAME, 0);
+	      else
+		addrpmrule_q(solv, ruleq, -n, -p, SOLVER_RULE_RPM_IMPLICIT_OBSOLETES, s->name);
 	    }
 	}
-      if (s->suggests && m)
+    }
+
+  /*-----------------------------------------
+   * add recommends to the work queue
+   */
+  if (s->recommends && m)
+    {
+      recp = s->repo->idarraydata + s->recommends;
+      while ((rec = *recp++) != 0)
+	{
+	  FOR_PROVIDES(p, pp, rec)
+	    if (!MAPTST(m, p))
+	      queue_push(workq, p);
+	}
+    }
+  if (s->suggests && m)
+    {
+      sugp = s->repo->idarraydata + s->suggests;
+      while ((sug = *sugp++) != 0)
 	{
-	  sugp = s->repo->idarraydata + s->suggests;
-	  while ((sug = *sugp++) != 0)
-	    {
-	      FOR_PROVIDES(p, pp, sug)
-		if (!MAPTST(m, p))
-		  queue_push(&workq, p);
-	    }
+	  FOR_PROVIDES(p, pp, sug)
+	    if (!MAPTST(m, p))
+	      queue_push(workq, p);
+	}
+    }
+
+  return 1;
+}
+
+/*
+ * parallel rule creation
+ *
+ * The solvables in the work queue are split into chunks, each
+ * worker records the rules and the pushed solvables of its chunk.
+ * The results are then merged in work queue order, so we get
+ * exactly the rules (and the rule order) of the serial loop.
+ */
+
+#define RPMRULES_PARALLEL_MIN	128	/* min work queue size for the threads */
+
+struct rpmrulesworker {
+  Solver *solv;
+  Map *m;
+  Id *ids;
+  int start, end;
+  int *ruleend;		/* end offset into ruleq, -1: do it serially */
+  int *pushend;		/* end offset into pushq */
+  Queue ruleq;
+  Queue pushq;
+};
+
+static void *
+rpmrules_worker(void *data)
+{
+  struct rpmrulesworker *w = data;
+  int i, rstart, pstart;
+
+  for (i = w->start; i < w->end; i++)
+    {
+      rstart = w->ruleq.count;
+      pstart = w->pushq.count;
+      if (!addrpmrulesforsolvable_one(w->solv, w->ids[i], w->m, &w->pushq, &w->ruleq))
+	{
+	  queue_truncate(&w->ruleq, rstart);
+	  queue_truncate(&w->pushq, pstart);
+	  w->ruleend[i] = -1;
 	}
+      else
+	w->ruleend[i] = w->ruleq.count;
+      w->pushend[i] = w->pushq.count;
+    }
+  return 0;
+}
+
+static void
+addrpmrules_parallel(Solver *solv, Map *m, Queue *workq)
+{
+  struct rpmrulesworker *workers, *w;
+  pthread_t *threads;
+  Queue ids;
+  int *ruleend, *pushend;
+  int i, j, k, t, nthreads, nstarted;
+  Id n;
+
+  /* take the whole work queue. Marking the solvables here instead
+   * of when they are processed only drops pushes that the serial
+   * loop would skip anyway. */
+  queue_init(&ids);
+  for (i = 0; i < workq->count; i++)
+    {
+      n = workq->elements[i];
+      if (MAPTST(m, n))
+	continue;
+      MAPSET(m, n);
+      queue_push(&ids, n);
+    }
+  queue_empty(workq);
+  if (!ids.count)
+    {
+      queue_free(&ids);
+      return;
+    }
+
+  nthreads = solv->rpmrulethreads;
+  if (nthreads > ids.count)
+    nthreads = ids.count;
+  ruleend = sat_calloc(ids.count, sizeof(int));
+  pushend = sat_calloc(ids.count, sizeof(int));
+  workers = sat_calloc(nthreads, sizeof(*workers));
+  for (t = 0; t < nthreads; t++)
+    {
+      w = workers + t;
+      w->solv = solv;
+      w->m = m;
+      w->ids = ids.elements;
+      w->start = (long long)ids.count * t / nthreads;
+      w->end = (long long)ids.count * (t + 1) / nthreads;
+      w->ruleend = ruleend;
+      w->pushend = pushend;
+      queue_init(&w->ruleq);
+      queue_init(&w->pushq);
+    }
+  /* the calling thread does the first chunk */
+  threads = sat_calloc(nthreads, sizeof(pthread_t));
+  for (nstarted = 1; nstarted < nthreads; nstarted++)
+    if (pthread_create(threads + nstarted, 0, rpmrules_worker, workers + nstarted) != 0)
+      break;
+  for (t = nstarted; t < nthreads; t++)
+    rpmrules_worker(workers + t);
+  rpmrules_worker(workers);
+  for (t = 1; t < nstarted; t++)
+    pthread_join(threads[t], 0);
+  sat_free(threads);
+
+  /* merge in work queue order */
+  for (t = 0; t < nthreads; t++)
+    {
+      w = workers + t;
+      j = k = 0;
+      for (i = w->start; i < w->end; i++)
+	{
+	  if (ruleend[i] < 0)
+	    addrpmrulesforsolvable_one(solv, ids.elements[i], m, workq, 0);
+	  else
+	    for (; j < ruleend[i]; j += 2)
+	      solver_addrule(solv, w->ruleq.elements[j], w->ruleq.elements[j + 1]);
+	  for (; k < pushend[i]; k++)
+	    if (!MAPTST(m, w->pushq.elements[k]))
+	      queue_push(workq, w->pushq.elements[k]);
+	}
+      queue_free(&w->ruleq);
+      queue_free(&w->pushq);
+    }
+  sat_free(workers);
+  sat_free(ruleend);
+  sat_free(pushend);
+  queue_free(&ids);
+}
+
+/*-------------------------------------------------------------------
+ * 
+ * add (install) rules for solvable
+ * 
+ * s: Solvable for which to add rules
+ * m: m[s] = 1 for solvables which have rules, prevent rule duplication
+ * 
+ * Algorithm: 'visit all nodes of a graph'. The graph nodes are
+ *  solvables, the edges their dependencies.
+ *  Starting from an installed solvable, this will create all rules
+ *  representing the graph created by the solvables dependencies.
+ * 
+ * for unfulfilled requirements, conflicts, obsoletes,....
+ * add a negative assertion for solvables that are not installable
+ * 
+ * It will also create rules for all solvables referenced by 's'
+ *  i.e. descend to all providers of requirements of 's'
+ *
+ */
+
+void
+solver_addrpmrulesforsolvable(Solver *solv, Solvable *s, Map *m)
+{
+  Pool *pool = solv->pool;
+
+  /* 'work' queue. keeps Ids of solvables we still have to work on. */
+  Queue workq;
+  Id n;			/* Id for current solvable 's' */
+  int parallel;
+  size_t scratchmark = scratch_mark(&solv->scratch);
+
+  POOL_DEBUG(SAT_DEBUG_SCHUBI, "----- addrpmrulesforsolvable -----\n");
+
+  /* the workers need a frozen pool, no rule info and no debug output */
+  parallel = m && solv->rpmrulethreads > 1 && pool->frozen && !solv->ruleinfoq && !(pool->debugmask & SAT_DEBUG_RULE_CREATION);
+
+  scratch_queue_init(&solv->scratch, &workq, 4096);
+  queue_push(&workq, s - pool->solvables);	/* push solvable Id to work queue */
+
+  /* loop until there's no more work left */
+  while (workq.count)
+    {
+      if (parallel && workq.count >= RPMRULES_PARALLEL_MIN)
+	{
+	  addrpmrules_parallel(solv, m, &workq);
+	  continue;
+	}
+
+      /*
+       * n: Id of solvable
+       */
+
+      n = queue_shift(&workq);		/* 'pop' next solvable to work on from queue */
+      if (m)
+	{
+	  if (MAPTST(m, n))		/* continue if already visited */
+	    continue;
+	  MAPSET(m, n);			/* mark as visited */
+	}
+      addrpmrulesforsolvable_one(solv, n, m, &workq, 0);
     }
   queue_free(&workq);
+  scratch_release(&solv->scratch, scratchmark);
   POOL_DEBUG(SAT_DEBUG_SCHUBI, "----- addrpmrulesforsolvable end -----\n");
 }
 
@@ -941,7 +1110,7 @@ solver_addupdaterule(Solver *solv, Solvable *s, int allow_all)
     {
       int i, j;
 
-      d = pool_queuetowhatprovides(pool, &qs);
+      d = solver_queuetowhatprovides(solv, &qs);
       /* filter out all noobsoletes packages as they don't update */
       for (i = j = 0; i < qs.count; i++)
 	{
@@ -968,12 +1137,12 @@ solver_addupdaterule(Solver *solv, Solvable *s, int allow_all)
 	      queue_push(&solv->orphaned, s - pool->solvables);	/* treat as orphaned */
 	      j = qs.count;
 	    }
-	  qs.count = j;
+	  queue_truncate(&qs, j);
 	}
     }
   if (qs.count && p == -SYSTEMSOLVABLE)
     p = queue_shift(&qs);
-  d = qs.count ? pool_queuetowhatprovides(pool, &qs) : 0;
+  d = qs.count ? solver_queuetowhatprovides(solv, &qs) : 0;
   queue_free(&qs);
   solver_addrule(solv, p, d);	/* allow update of s */
   POOL_DEBUG(SAT_DEBUG_SCHUBI, "-----  addupdaterule end -----\n");
@@ -1043,9 +1212,10 @@ solver_addinfarchrules(Solver *solv, Map *addedmap)
   Id p, pp, a, aa, bestarch;
   Solvable *s, *ps, *bests;
   Queue badq, allowedarchs;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
-  queue_init(&badq);
-  queue_init(&allowedarchs);
+  scratch_queue_init(&solv->scratch, &badq, 16);
+  scratch_queue_init(&solv->scratch, &allowedarchs, 16);
   solv->infarchrules = solv->nrules;
   for (i = 1; i < pool->nsolvables; i++)
     {
@@ -1083,7 +1253,7 @@ solver_addinfarchrules(Solver *solv, Map *addedmap)
 	continue;
       /* speed up common case where installed package already has best arch */
       if (allowedarchs.count == 1 && bests && allowedarchs.elements[0] == bests->arch)
-	allowedarchs.count--;	/* installed arch is best */
+	queue_empty(&allowedarchs);	/* installed arch is best */
       queue_empty(&badq);
       FOR_PROVIDES(p, pp, s->name)
 	{
@@ -1120,6 +1290,7 @@ solver_addinfarchrules(Solver *solv, Map *addedmap)
     }
   queue_free(&badq);
   queue_free(&allowedarchs);
+  scratch_release(&solv->scratch, scratchmark);
   solv->infarchrules_end = solv->nrules;
 }
 
@@ -1679,7 +1850,6 @@ solver_reenablepolicyrules(Solver *solv, int jobidx)
 static void
 addrpmruleinfo(Solver *solv, Id p, Id d, int type, Id dep)
 {
-  Pool *pool = solv->pool;
   Rule *r;
   Id w2, op, od, ow2;
 
@@ -1691,9 +1861,9 @@ addrpmruleinfo(Solver *solv, Id p, Id d, int type, Id dep)
 
   /* normalize */
   w2 = d > 0 ? 0 : d;
-  if (p < 0 && d > 0 && (!pool->whatprovidesdata[d] || !pool->whatprovidesdata[d + 1]))
+  if (p < 0 && d > 0 && (!solver_whatprovidesdata(solv, d)[0] || !solver_whatprovidesdata(solv, d)[1]))
     {
-      w2 = pool->whatprovidesdata[d];
+      w2 = *solver_whatprovidesdata(solv, d);
       d = 0;
 
     }
@@ -1709,8 +1879,8 @@ addrpmruleinfo(Solver *solv, Id p, Id d, int type, Id dep)
 	return;
       if (d != od)
 	{
-	  Id *dp = pool->whatprovidesdata + d;
-	  Id *odp = pool->whatprovidesdata + od;
+	  Id *dp = solver_whatprovidesdata(solv, d);
+	  Id *odp = solver_whatprovidesdata(solv, od);
 	  while (*dp)
 	    if (*dp++ != *odp++)
 	      return;
@@ -1719,9 +1889,9 @@ addrpmruleinfo(Solver *solv, Id p, Id d, int type, Id dep)
 	}
       w2 = 0;
       /* handle multiversion conflict rules */
-      if (p < 0 && pool->whatprovidesdata[d] < 0)
+      if (p < 0 && *solver_whatprovidesdata(solv, d) < 0)
 	{
-	  w2 = pool->whatprovidesdata[d];
+	  w2 = *solver_whatprovidesdata(solv, d);
 	  /* XXX: free memory */
 	}
     }
@@ -1826,7 +1996,7 @@ solver_allruleinfos(Solver *solv, Id rid, Queue *rq)
       rq->elements[j++] = rq->elements[i + 2];
       rq->elements[j++] = rq->elements[i + 3];
     }
-  rq->count = j;
+  queue_truncate(rq, j);
   return j / 4;
 }
 
@@ -1934,17 +2104,84 @@ solver_ruleinfo(Solver *solv, Id rid, Id *fromp, Id *top, Id *depp)
   return SOLVER_RULE_UNKNOWN;
 }
 
+/*
+ * find the installed package that package p would update, i.e. that
+ * has the same name or is obsoleted by p.
+ * returns CHOICE_INDEPENDENT if there is no such package and
+ * CHOICE_BLOCKED if p must not be used to update it.
+ */
+#define CHOICE_UNKNOWN		0
+#define CHOICE_INDEPENDENT	-1
+#define CHOICE_BLOCKED		-2
+#define CHOICE_NEGATED		-3	/* unknown, but negated by an infarch or dup rule */
+
+static Id
+findupdatedpkg(Solver *solv, Id p, int negated)
+{
+  Pool *pool = solv->pool;
+  Solvable *s = pool->solvables + p;
+  Solvable *s2 = 0;
+  Id p2, pp2;
+
+  /* check if this package is "blocked" by a installed package */
+  FOR_PROVIDES(p2, pp2, s->name)
+    {
+      s2 = pool->solvables + p2;
+      if (s2->repo != pool->installed)
+	continue;
+      if (!pool->implicitobsoleteusesprovides && s->name != s2->name)
+	continue;
+      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
+	continue;
+      break;
+    }
+  if (!p2 && s->obsoletes)
+    {
+      Id obs, *obsp = s->repo->idarraydata + s->obsoletes;
+      while ((obs = *obsp++) != 0)
+	{
+	  FOR_PROVIDES(p2, pp2, obs)
+	    {
+	      s2 = pool->solvables + p2;
+	      if (s2->repo != pool->installed)
+		continue;
+	      if (!pool->obsoleteusesprovides && !pool_match_nevr(pool, pool->solvables + p2, obs))
+		continue;
+	      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
+		continue;
+	      break;
+	    }
+	  if (p2)
+	    break;
+	}
+    }
+  if (!p2)
+    return CHOICE_INDEPENDENT;	/* package p is independent of the installed ones */
+  /* found installed package p2 that we can update to p */
+  if (negated || policy_is_illegal(solv, s2, s, 0))
+    return CHOICE_BLOCKED;
+  return p2;
+}
+
+/*
+ * The packages a requires rule can be fulfilled with are looked at
+ * again and again for every rule they appear in. The installed package
+ * they would update does not depend on the rule, so it is computed once
+ * and cached in 'updated'. The negative assertions of the infarch and
+ * dup rules are folded into that cache.
+ */
 void
 solver_addchoicerules(Solver *solv)
 {
   Pool *pool = solv->pool;
-  Map m, mneg;
+  Map m;
   Rule *r;
   Queue q, qi;
   int i, j, rid, havechoice;
-  Id p, d, *pp;
-  Id p2, pp2;
-  Solvable *s, *s2;
+  Id p, d, p2, *pp;
+  Id *updated;
+  Solvable *s;
+  size_t scratchmark;
 
   solv->choicerules = solv->nrules;
   if (!pool->installed)
@@ -1953,17 +2190,18 @@ solver_addchoicerules(Solver *solv)
       return;
     }
   solv->choicerules_ref = sat_calloc(solv->rpmrules_end, sizeof(Id));
-  queue_init(&q);
-  queue_init(&qi);
-  map_init(&m, pool->nsolvables);
-  map_init(&mneg, pool->nsolvables);
-  /* set up negative assertion map from infarch and dup rules */
+  scratchmark = scratch_mark(&solv->scratch);
+  scratch_queue_init(&solv->scratch, &q, 256);
+  scratch_queue_init(&solv->scratch, &qi, 256);
+  scratch_map_init(&solv->scratch, &m, pool->nsolvables);
+  updated = scratch_calloc(&solv->scratch, pool->nsolvables, sizeof(Id));
+  /* set up negative assertions from infarch and dup rules */
   for (rid = solv->infarchrules, r = solv->rules + rid; rid < solv->infarchrules_end; rid++, r++)
     if (r->p < 0 && !r->w2 && (r->d == 0 || r->d == -1))
-      MAPSET(&mneg, -r->p);
+      updated[-r->p] = CHOICE_NEGATED;
   for (rid = solv->duprules, r = solv->rules + rid; rid < solv->duprules_end; rid++, r++)
     if (r->p < 0 && !r->w2 && (r->d == 0 || r->d == -1))
-      MAPSET(&mneg, -r->p);
+      updated[-r->p] = CHOICE_NEGATED;
   for (rid = 1; rid < solv->rpmrules_end ; rid++)
     {
       r = solv->rules + rid;
@@ -1985,72 +2223,27 @@ solver_addchoicerules(Solver *solv)
 	      queue_push(&q, p);
 	      continue;
 	    }
-	  /* check if this package is "blocked" by a installed package */
-	  s2 = 0;
-	  FOR_PROVIDES(p2, pp2, s->name)
-	    {
-	      s2 = pool->solvables + p2;
-	      if (s2->repo != pool->installed)
-		continue;
-	      if (!pool->implicitobsoleteusesprovides && s->name != s2->name)
-	        continue;
-	      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
-	        continue;
-	      break;
-	    }
-	  if (p2)
+	  p2 = updated[p];
+	  if (p2 == CHOICE_UNKNOWN || p2 == CHOICE_NEGATED)
+	    p2 = updated[p] = findupdatedpkg(solv, p, p2 == CHOICE_NEGATED);
+	  if (p2 == CHOICE_BLOCKED)
+	    continue;
+	  if (p2 == CHOICE_INDEPENDENT)
 	    {
-	      /* found installed package p2 that we can update to p */
-	      if (MAPTST(&mneg, p))
-		continue;
-	      if (policy_is_illegal(solv, s2, s, 0))
-		continue;
-	      queue_push(&qi, p2);
-	      queue_push(&q, p);
+	      havechoice = 1;
 	      continue;
 	    }
-	  if (s->obsoletes)
-	    {
-	      Id obs, *obsp = s->repo->idarraydata + s->obsoletes;
-	      s2 = 0;
-	      while ((obs = *obsp++) != 0)
-		{
-		  FOR_PROVIDES(p2, pp2, obs)
-		    {
-		      s2 = pool->solvables + p2;
-		      if (s2->repo != pool->installed)
-			continue;
-		      if (!pool->obsoleteusesprovides && !pool_match_nevr(pool, pool->solvables + p2, obs))
-			continue;
-		      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
-			continue;
-		      break;
-		    }
-		  if (p2)
-		    break;
-		}
-	      if (obs)
-		{
-		  /* found installed package p2 that we can update to p */
-		  if (MAPTST(&mneg, p))
-		    continue;
-		  if (policy_is_illegal(solv, s2, s, 0))
-		    continue;
-		  queue_push(&qi, p2);
-		  queue_push(&q, p);
-		  continue;
-		}
-	    }
-	  /* package p is independent of the installed ones */
-	  havechoice = 1;
+	  queue_push(&qi, p2);
+	  queue_push(&q, p);
 	}
       if (!havechoice || !q.count)
 	continue;	/* no choice */
 
       /* now check the update rules of the installed package.
        * if all packages of the update rules are contained in
-       * the dependency rules, there's no need to set up the choice rule */
-      map_empty(&m);
+       * the dependency rules, there's no need to set up the choice rule.
+       * Only the bits of the rule literals are set in m, they get
+       * cleared again afterwards */
       FOR_RULELITERALS(p, pp, r)
         if (p > 0)
 	  MAPSET(&m, p);
@@ -2072,6 +2265,9 @@ solver_addchoicerules(Solver *solv)
 	    if (qi.elements[i] == qi.elements[j])
 	      qi.elements[j] = 0;
 	}
+      FOR_RULELITERALS(p, pp, r)
+        if (p > 0)
+	  MAPCLR(&m, p);
       if (i == qi.count)
 	{
 #if 0
@@ -2080,7 +2276,7 @@ solver_addchoicerules(Solver *solv)
 #endif
 	  continue;
 	}
-      d = q.count ? pool_queuetowhatprovides(pool, &q) : 0;
+      d = q.count ? solver_queuetowhatprovides(solv, &q) : 0;
       solver_addrule(solv, r->p, d);
       queue_push(&solv->weakruleq, solv->nrules - 1);
       solv->choicerules_ref[solv->nrules - 1 - solv->choicerules] = rid;
@@ -2093,8 +2289,7 @@ solver_addchoicerules(Solver *solv)
     }
   queue_free(&q);
   queue_free(&qi);
-  map_free(&m);
-  map_free(&mneg);
+  scratch_release(&solv->scratch, scratchmark);
   solv->choicerules_end = solv->nrules;
 }
 
@@ -2108,9 +2303,10 @@ solver_disablechoicerules(Solver *solv, Rule *r)
   Pool *pool = solv->pool;
   Map m;
   Rule *or;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
   or = solv->rules + solv->choicerules_ref[(r - solv->rules) - solv->choicerules];
-  map_init(&m, pool->nsolvables);
+  scratch_map_init(&solv->scratch, &m, pool->nsolvables);
   FOR_RULELITERALS(p, pp, or)
     if (p > 0)
       MAPSET(&m, p);
@@ -2129,8 +2325,31 @@ solver_disablechoicerules(Solver *solv, Rule *r)
       if (p)
 	solver_disablerule(solv, r);
     }
+  scratch_release(&solv->scratch, scratchmark);
 }
 
+/*
+ * add the installed packages supplementing p to the queue, they
+ * need to be checked again when p gets removed or kept
+ */
+static inline void
+queuesupplementers(Pool *pool, Id p, Map *installedm, Queue *q)
+{
+  Id *dp;
+
+  for (dp = pool_whatrequires_ptr(pool, p, SOLVABLE_SUPPLEMENTS); (p = *dp++) != 0; )
+    if (MAPTST(installedm, p))
+      queue_push(q, p);
+}
+
+/*
+ * the cleandeps map: all installed packages that are no longer needed
+ * once the packages of the erase jobs with SOLVER_CLEANDEPS are gone.
+ * The kept packages are found by following the requires, recommends and
+ * supplements. Only the removed packages and the packages depending
+ * on them are looked at, the dependencies of the others come from the
+ * pool's reverse dependency index.
+ */
 static void solver_createcleandepsmap(Solver *solv)
 {
   Pool *pool = solv->pool;
@@ -2141,17 +2360,19 @@ static void solver_createcleandepsmap(Solver *solv)
   Map installedm;
   Rule *r;
   Id rid, how, what, select;
-  Id p, pp, ip, *jp;
+  Id p, pp, ip, *jp, *dp;
   Id req, *reqp, sup, *supp;
   Solvable *s;
-  Queue iq;
+  Queue iq, sq;
   int i;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
-  map_init(&userinstalled, installed->end - installed->start);
-  map_init(&im, pool->nsolvables);
-  map_init(&installedm, pool->nsolvables);
+  scratch_map_init(&solv->scratch, &userinstalled, installed->end - installed->start);
+  scratch_map_init(&solv->scratch, &im, pool->nsolvables);
+  scratch_map_init(&solv->scratch, &installedm, pool->nsolvables);
   map_empty(&solv->cleandepsmap);
-  queue_init(&iq);
+  scratch_queue_init(&solv->scratch, &iq, 256);
+  scratch_queue_init(&solv->scratch, &sq, 256);
 
   for (i = 0; i < job->count; i += 2)
     {
@@ -2208,6 +2429,7 @@ static void solver_createcleandepsmap(Solver *solv)
       if (s->repo == installed && MAPTST(&userinstalled, ip - installed->start))
 	continue;
       MAPCLR(&im, ip);
+      queuesupplementers(pool, ip, &installedm, &sq);
 #ifdef CLEANDEPSDEBUG
       printf("hello %s\n", solvable2str(pool, s));
 #endif
@@ -2266,16 +2488,16 @@ static void solver_createcleandepsmap(Solver *solv)
 	}
       if (!iq.count)
 	{
-	  /* supplements pass */
-	  for (ip = solv->installed->start; ip < solv->installed->end; ip++)
+	  /* supplements pass, only the supplementers of removed
+	   * packages can have lost their supplements */
+	  for (i = 0; i < sq.count; i++)
 	    {
-	      if (!MAPTST(&installedm, ip))
+	      ip = sq.elements[i];
+	      if (!MAPTST(&im, ip))
 		continue;
 	      s = pool->solvables + ip;
 	      if (!s->supplements)
 		continue;
-	      if (!MAPTST(&im, ip))
-		continue;
 	      supp = s->repo->idarraydata + s->supplements;
 	      while ((sup = *supp++) != 0)
 		if (!dep_possible(solv, sup, &im) && dep_possible(solv, sup, &installedm))
@@ -2289,6 +2511,7 @@ static void solver_createcleandepsmap(Solver *solv)
 		  queue_push(&iq, ip);
 		}
 	    }
+	  queue_empty(&sq);
 	}
     }
 
@@ -2304,9 +2527,12 @@ static void solver_createcleandepsmap(Solver *solv)
       if (pool->solvables[p].repo == installed)
         MAPSET(&userinstalled, p - installed->start);
     }
+  /* the removed packages are the candidates for getting back in. Instead
+   * of following the dependencies of all kept packages we check if
+   * a kept package requires or recommends a candidate */
   for (p = installed->start; p < installed->end; p++)
-    if (MAPTST(&im, p))
-      queue_push(&iq, p);
+    if (MAPTST(&installedm, p) && !MAPTST(&im, p))
+      queue_push(&sq, p);
   for (rid = solv->jobrules; rid < solv->jobrules_end; rid++)
     {
       r = solv->rules + rid;
@@ -2329,8 +2555,51 @@ static void solver_createcleandepsmap(Solver *solv)
             queue_push(&iq, what);
 	}
     }
-  while (iq.count)
+  while (iq.count || sq.count)
     {
+      if (!iq.count)
+	{
+	  /* look at the candidates */
+	  for (i = 0; i < sq.count; i++)
+	    {
+	      ip = sq.elements[i];
+	      if (MAPTST(&im, ip) || MAPTST(&userinstalled, ip - installed->start))
+		continue;
+	      /* needed by a kept package? */
+	      for (dp = pool_whatrequires_ptr(pool, ip, SOLVABLE_REQUIRES); (p = *dp) != 0; dp++)
+		if (p != ip && MAPTST(&im, p))
+		  break;
+	      if (!p)
+		for (dp = pool_whatrequires_ptr(pool, ip, SOLVABLE_RECOMMENDS); (p = *dp) != 0; dp++)
+		  if (p != ip && MAPTST(&im, p))
+		    break;
+#ifdef CLEANDEPSDEBUG
+	      if (p)
+		printf("%s needs %s\n", solvid2str(pool, p), solvid2str(pool, ip));
+#endif
+	      s = pool->solvables + ip;
+	      if (!p && s->supplements)
+		{
+		  supp = s->repo->idarraydata + s->supplements;
+		  while ((sup = *supp++) != 0)
+		    if (dep_possible(solv, sup, &im))
+		      break;
+#ifdef CLEANDEPSDEBUG
+		  if (sup)
+		    printf("%s supplemented\n", solvid2str(pool, ip));
+#endif
+		  p = sup;
+		}
+	      if (p)
+		{
+		  MAPSET(&im, ip);
+		  queue_push(&iq, ip);
+		  queuesupplementers(pool, ip, &installedm, &sq);
+		}
+	    }
+	  queue_empty(&sq);
+	  continue;
+	}
       ip = queue_shift(&iq);
       s = pool->solvables + ip;
 #ifdef CLEANDEPSDEBUG
@@ -2354,6 +2623,7 @@ static void solver_createcleandepsmap(Solver *solv)
 #endif
 		      MAPSET(&im, p);
 		      queue_push(&iq, p);
+		      queuesupplementers(pool, p, &installedm, &sq);
 		    }
 		}
 	    }
@@ -2376,41 +2646,15 @@ static void solver_createcleandepsmap(Solver *solv)
 #endif
 		      MAPSET(&im, p);
 		      queue_push(&iq, p);
+		      queuesupplementers(pool, p, &installedm, &sq);
 		    }
 		}
 	    }
 	}
-      if (!iq.count)
-	{
-	  /* supplements pass */
-	  for (ip = installed->start; ip < installed->end; ip++)
-	    {
-	      if (!MAPTST(&installedm, ip))
-		continue;
-	      if (MAPTST(&userinstalled, ip - installed->start))
-	        continue;
-	      s = pool->solvables + ip;
-	      if (!s->supplements)
-		continue;
-	      if (MAPTST(&im, ip) || !MAPTST(&installedm, ip))
-		continue;
-	      supp = s->repo->idarraydata + s->supplements;
-	      while ((sup = *supp++) != 0)
-		if (dep_possible(solv, sup, &im))
-		  break;
-	      if (sup)
-		{
-#ifdef CLEANDEPSDEBUG
-		  printf("%s supplemented\n", solvid2str(pool, ip));
-#endif
-		  MAPSET(&im, ip);
-		  queue_push(&iq, ip);
-		}
-	    }
-	}
     }
     
   queue_free(&iq);
+  queue_free(&sq);
   for (p = installed->start; p < installed->end; p++)
     {
       if (pool->solvables[p].repo != installed)
@@ -2418,9 +2662,7 @@ static void solver_createcleandepsmap(Solver *solv)
       if (!MAPTST(&im, p))
         MAPSET(&solv->cleandepsmap, p - installed->start);
     }
-  map_free(&im);
-  map_free(&installedm);
-  map_free(&userinstalled);
+  scratch_release(&solv->scratch, scratchmark);
 }
 
 
@@ -42,7 +42,6 @@ typedef struct _Rule {
 		/* in case of disabled rules: ~d, aka -d - 1 */
   Id w1, w2;	/* watches, literals not-yet-decided */
 		/* if !w2, assertion, not rule */
-  Id n1, n2;	/* next rules in linked list, corresponding to w1, w2 */
 } Rule;
 
 
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * scratch.c
+ *
+ * bump allocator for temporary data. Allocations are taken from
+ * big blocks, scratch_release() gives back everything allocated
+ * since the corresponding scratch_mark() in one go. Released
+ * blocks are kept for reuse, so a warmed up scratch area does
+ * not call malloc at all.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "scratch.h"
+#include "util.h"
+
+#define SCRATCH_BLOCKSIZE 65536
+
+struct _Scratchblock {
+  struct _Scratchblock *prev;	/* block allocated before this one */
+  size_t start;			/* mark of the first byte of this block */
+  size_t size;
+};
+
+#define SCRATCHBLOCK_DATA(b) ((char *)((b) + 1))
+
+void
+scratch_init(Scratch *sc)
+{
+  memset(sc, 0, sizeof(*sc));
+}
+
+static void
+freeblocks(struct _Scratchblock *b)
+{
+  struct _Scratchblock *prev;
+  for (; b; b = prev)
+    {
+      prev = b->prev;
+      sat_free(b);
+    }
+}
+
+void
+scratch_free(Scratch *sc)
+{
+  freeblocks(sc->block);
+  freeblocks(sc->spare);
+  memset(sc, 0, sizeof(*sc));
+}
+
+size_t
+scratch_mark(Scratch *sc)
+{
+  return sc->block ? sc->block->start + sc->used : 0;
+}
+
+/* switch to a block with at least len free bytes */
+static void
+newblock(Scratch *sc, size_t len)
+{
+  struct _Scratchblock *b, **bp;
+  size_t size;
+
+  for (bp = &sc->spare; (b = *bp) != 0; bp = &b->prev)
+    if (b->size >= len)
+      break;
+  if (b)
+    *bp = b->prev;
+  else
+    {
+      size = sc->block ? 2 * sc->block->size : SCRATCH_BLOCKSIZE;
+      if (size < len)
+	size = len;
+      b = sat_malloc(sizeof(*b) + size);
+      b->size = size;
+      sc->nblocks++;
+    }
+  b->start = scratch_mark(sc);
+  b->prev = sc->block;
+  sc->block = b;
+  sc->used = 0;
+}
+
+void *
+scratch_alloc(Scratch *sc, size_t len)
+{
+  char *p;
+
+  len = (len + 7) & ~(size_t)7;
+  if (!sc->block || sc->used + len > sc->block->size)
+    newblock(sc, len);
+  p = SCRATCHBLOCK_DATA(sc->block) + sc->used;
+  sc->used += len;
+  return p;
+}
+
+void *
+scratch_calloc(Scratch *sc, size_t nmemb, size_t size)
+{
+  void *p = scratch_alloc(sc, nmemb * size);
+  memset(p, 0, nmemb * size);
+  return p;
+}
+
+/* free everything allocated after mark was taken */
+void
+scratch_release(Scratch *sc, size_t mark)
+{
+  struct _Scratchblock *b;
+
+  while ((b = sc->block) != 0 && b->start > mark)
+    {
+      sc->block = b->prev;
+      b->prev = sc->spare;
+      sc->spare = b;
+    }
+  sc->used = b ? mark - b->start : 0;
+}
+
+void
+scratch_queue_init(Scratch *sc, Queue *q, int size)
+{
+  queue_init_buffer(q, scratch_alloc(sc, size * sizeof(Id)), size);
+}
+
+void
+scratch_map_init(Scratch *sc, Map *m, int n)
+{
+  m->size = (n + 7) >> 3;
+  m->map = m->size ? scratch_calloc(sc, m->size, 1) : 0;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * scratch.h
+ *
+ * bump allocator for temporary data with scoped mark/release
+ */
+
+#ifndef SATSOLVER_SCRATCH_H
+#define SATSOLVER_SCRATCH_H
+
+#include <stddef.h>
+
+#include "queue.h"
+#include "bitmap.h"
+
+struct _Scratchblock;
+
+typedef struct _Scratch {
+  struct _Scratchblock *block;	/* block we allocate from */
+  size_t used;			/* bytes used in block */
+  struct _Scratchblock *spare;	/* released blocks, kept for reuse */
+  unsigned int nblocks;		/* number of malloced blocks */
+} Scratch;
+
+extern void scratch_init(Scratch *sc);
+extern void scratch_free(Scratch *sc);
+extern void *scratch_alloc(Scratch *sc, size_t len);
+extern void *scratch_calloc(Scratch *sc, size_t nmemb, size_t size);
+extern size_t scratch_mark(Scratch *sc);
+extern void scratch_release(Scratch *sc, size_t mark);
+
+/* a queue starting with room for size elements in the scratch area.
+ * It falls back to malloc if it grows bigger, so queue_free() must
+ * still be called on it. */
+extern void scratch_queue_init(Scratch *sc, Queue *q, int size);
+/* a map living in the scratch area, must not be freed with map_free() */
+extern void scratch_map_init(Scratch *sc, Map *m, int n);
+
+#endif /* SATSOLVER_SCRATCH_H */
@@ -82,7 +82,7 @@ solvable_lookup_str_base(Solvable *s, Id keyname, Id basekeyname, int usebase)
     return 0;
   /* search for a solvable with same name and same base that has the
    * translation */
-  if (!pool->whatprovides)
+  if (!pool->whatprovides || pool->whatprovidesstale)
     return usebase ? basestr : 0;
   /* we do this in two passes, first same vendor, then all other vendors */
   for (pass = 0; pass < 2; pass++)
@@ -105,6 +105,23 @@ solvable_lookup_str_base(Solvable *s, Id keyname, Id basekeyname, int usebase)
   return usebase ? basestr : 0;
 }
 
+/* language lookup without the cache, used for frozen pools */
+static const char *
+solvable_lookup_str_poollang_nocache(Solvable *s, Id keyname)
+{
+  Pool *pool = s->repo->pool;
+  int i;
+  const char *str;
+
+  for (i = 0; i < pool->nlanguages; i++)
+    {
+      str = solvable_lookup_str_lang(s, keyname, pool->languages[i], 0);
+      if (str)
+	return str;
+    }
+  return solvable_lookup_str(s, keyname);
+}
+
 const char *
 solvable_lookup_str_poollang(Solvable *s, Id keyname)
 {
@@ -121,6 +138,8 @@ solvable_lookup_str_poollang(Solvable *s, Id keyname)
   cols = pool->nlanguages + 1;
   if (!pool->languagecache)
     {
+      if (pool->frozen)
+	return solvable_lookup_str_poollang_nocache(s, keyname);
       pool->languagecache = sat_calloc(cols * ID_NUM_INTERNAL, sizeof(Id));
       pool->languagecacheother = 0;
     }
@@ -132,6 +151,8 @@ solvable_lookup_str_poollang(Solvable *s, Id keyname)
 	  break;
       if (i >= pool->languagecacheother)
 	{
+	  if (pool->frozen)
+	    return solvable_lookup_str_poollang_nocache(s, keyname);
 	  pool->languagecache = sat_realloc2(pool->languagecache, pool->languagecacheother + 1, cols * sizeof(Id));
 	  row = pool->languagecache + cols * (ID_NUM_INTERNAL + pool->languagecacheother++);
 	  *row = keyname;
@@ -143,7 +164,11 @@ solvable_lookup_str_poollang(Solvable *s, Id keyname)
   for (i = 0; i < pool->nlanguages; i++, row++)
     {
       if (!*row)
-        *row = pool_id2langid(pool, keyname, pool->languages[i], 1);
+	{
+	  if (pool->frozen)
+	    return solvable_lookup_str_poollang_nocache(s, keyname);
+	  *row = pool_id2langid(pool, keyname, pool->languages[i], 1);
+	}
       str = solvable_lookup_str_base(s, *row, keyname, 0);
       if (str)
 	return str;
@@ -26,6 +26,9 @@
 
 #define RULES_BLOCK 63
 
+#define LEARNT_REDUCE_START 2000	/* reduce learnt rules when there are this many */
+#define LEARNT_REDUCE_INC 300		/* and allow this many more after each round */
+
 /********************************************************************
  *
  * dependency check helpers
@@ -94,6 +97,33 @@ solver_dep_installed(Solver *solv, Id dep)
 }
 
 
+/*-------------------------------------------------------------------
+ * solver_queuetowhatprovides
+ *
+ * like pool_queuetowhatprovides, but frozen pools are not touched,
+ * the list is added to the solver's own data instead
+ */
+
+#define WHATPROVIDESAUX_BLOCK 4095
+
+Id
+solver_queuetowhatprovides(Solver *solv, Queue *q)
+{
+  Id off;
+
+  if (!solv->pool->frozen)
+    return pool_queuetowhatprovides(solv->pool, q);
+  if (!q->count)
+    return 1;
+  off = solv->nwhatprovidesauxdata;
+  solv->whatprovidesauxdata = sat_extend(solv->whatprovidesauxdata, off, q->count + 1, sizeof(Id), WHATPROVIDESAUX_BLOCK);
+  memcpy(solv->whatprovidesauxdata + off, q->elements, q->count * sizeof(Id));
+  solv->whatprovidesauxdata[off + q->count] = 0;
+  solv->nwhatprovidesauxdata += q->count + 1;
+  return off | SOLVER_WHATPROVIDES_AUX;
+}
+
+
 
 /************************************************************************/
 
@@ -415,6 +445,60 @@ enabledisablelearntrules(Solver *solv)
 /********************************************************************/
 /* watches */
 
+/*
+ * every literal has a contiguous list of watchers, i.e. (rule id,
+ * blocker literal) pairs. New watchers are appended at the end,
+ * propagate() walks the list backwards so that the newest watcher
+ * is looked at first.
+ * All lists live in solv->watchdata. A list that runs out of space
+ * is moved to the end of watchdata, the old space is not reused.
+ */
+
+#define WATCHES_BLOCK 7
+#define WATCHDATA_BLOCK 4095
+
+static void
+growwatchlist(Solver *solv, Watchlist *wl)
+{
+  int extra = (wl->count / 2 + 2 + WATCHES_BLOCK) & ~WATCHES_BLOCK;
+
+  if (wl->off + wl->count + wl->left != solv->nwatchdata)
+    {
+      /* not at the end, move it there */
+      solv->watchdata = sat_extend(solv->watchdata, solv->nwatchdata, wl->count + wl->left, sizeof(Id), WATCHDATA_BLOCK);
+      if (wl->count)
+	memcpy(solv->watchdata + solv->nwatchdata, solv->watchdata + wl->off, wl->count * sizeof(Id));
+      wl->off = solv->nwatchdata;
+      solv->nwatchdata += wl->count + wl->left;
+    }
+  solv->watchdata = sat_extend(solv->watchdata, solv->nwatchdata, extra, sizeof(Id), WATCHDATA_BLOCK);
+  solv->nwatchdata += extra;
+  wl->left += extra;
+}
+
+static inline void
+addwatch(Solver *solv, Watchlist *wl, Id rid, Id blocker)
+{
+  Id *wp;
+  if (wl->left < 2)
+    growwatchlist(solv, wl);
+  wp = solv->watchdata + wl->off + wl->count;
+  wp[0] = rid;
+  wp[1] = blocker;
+  wl->count += 2;
+  wl->left -= 2;
+}
+
+static void
+freewatches(Solver *solv)
+{
+  solv->binwatches = 0;
+  solv->watches = sat_free(solv->watches);
+  solv->nwatches = 0;
+  solv->watchdata = sat_free(solv->watchdata);
+  solv->nwatchdata = 0;
+}
+
 
 /*-------------------------------------------------------------------
  * makewatches
@@ -426,28 +510,59 @@ static void
 makewatches(Solver *solv)
 {
   Rule *r;
-  int i;
+  int i, n;
   int nsolvables = solv->pool->nsolvables;
+  Watchlist *watches, *binwatches, *wl;
 
-  sat_free(solv->watches);
+  /* reuse the lists of the last job if the pool did not grow */
+  if (solv->watches && solv->nwatches == 4 * nsolvables)
+    memset(solv->watches, 0, 4 * nsolvables * sizeof(Watchlist));
+  else
+    {
+      freewatches(solv);
 				       /* lower half for removals, upper half for installs */
-  solv->watches = sat_calloc(2 * nsolvables, sizeof(Id));
-#if 1
+      solv->watches = sat_calloc(4 * nsolvables, sizeof(Watchlist));
+      solv->nwatches = 4 * nsolvables;
+    }
+  solv->binwatches = solv->watches + 2 * nsolvables;
+  watches = solv->watches + nsolvables;
+  binwatches = solv->binwatches + nsolvables;
+
+  /* count the watchers first so that we can size the lists */
+  for (i = 1, r = solv->rules + i; i < solv->nrules; i++, r++)
+    {
+      if (!r->w2)		/* assertions do not need watches */
+	continue;
+      wl = r->d == 0 || r->d == -1 ? binwatches : watches;
+      wl[r->w1].left += 2;
+      wl[r->w2].left += 2;
+    }
+  /* leave room for at least one more watcher per list */
+  for (i = n = 0, wl = solv->watches; i < 4 * nsolvables; i++, wl++)
+    if (wl->left)
+      {
+	wl->off = n;
+	wl->left = (wl->left + 2 + WATCHES_BLOCK) & ~WATCHES_BLOCK;
+	n += wl->left;
+      }
+  solv->watchdata = sat_extend_resize(solv->watchdata, n, sizeof(Id), WATCHDATA_BLOCK);
+  solv->nwatchdata = n;
+
   /* do it reverse so rpm rules get triggered first (XXX: obsolete?) */
-  for (i = 1, r = solv->rules + solv->nrules - 1; i < solv->nrules; i++, r--)
-#else
-  for (i = 1, r = solv->rules + 1; i < solv->nrules; i++, r++)
-#endif
+  for (i = solv->nrules - 1, r = solv->rules + i; i > 0; i--, r--)
     {
       if (!r->w2)		/* assertions do not need watches */
 	continue;
 
       /* see addwatches_rule(solv, r) */
-      r->n1 = solv->watches[nsolvables + r->w1];
-      solv->watches[nsolvables + r->w1] = r - solv->rules;
-
-      r->n2 = solv->watches[nsolvables + r->w2];
-      solv->watches[nsolvables + r->w2] = r - solv->rules;
+      if (r->d == 0 || r->d == -1)
+	{
+	  addwatch(solv, binwatches + r->w1, r->w2, i);
+	  addwatch(solv, binwatches + r->w2, r->w1, i);
+	  continue;
+	}
+      addwatch(solv, watches + r->w1, i, r->w2);
+      addwatch(solv, watches + r->w2, i, r->w1);
     }
 }
 
@@ -465,11 +580,76 @@ addwatches_rule(Solver *solv, Rule *r)
 {
   int nsolvables = solv->pool->nsolvables;
 
-  r->n1 = solv->watches[nsolvables + r->w1];
-  solv->watches[nsolvables + r->w1] = r - solv->rules;
+  if (r->d == 0 || r->d == -1)
+    {
+      Watchlist *binwatches = solv->binwatches + nsolvables;
+      addwatch(solv, binwatches + r->w1, r->w2, r - solv->rules);
+      addwatch(solv, binwatches + r->w2, r->w1, r - solv->rules);
+    }
+  else
+    {
+      Watchlist *watches = solv->watches + nsolvables;
+      addwatch(solv, watches + r->w1, r - solv->rules, r->w2);
+      addwatch(solv, watches + r->w2, r - solv->rules, r->w1);
+    }
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * remove all watchers >= start from a watch list.
+ * the rule offset is in wp[0] for the normal lists and in
+ * wp[1] for the binary lists.
+ */
+
+static inline void
+truncatewatchlist(Solver *solv, Watchlist *wl, int ridoff, Id start)
+{
+  Id *wp, *wq, *wend;
+
+  wend = solv->watchdata + wl->off + wl->count;
+  for (wp = wq = solv->watchdata + wl->off; wp < wend; wp += 2)
+    if (wp[ridoff] < start)
+      {
+	*wq++ = wp[0];
+	*wq++ = wp[1];
+      }
+  wl->left += wend - wq;
+  wl->count = wq - (solv->watchdata + wl->off);
+}
+
+/*-------------------------------------------------------------------
+ *
+ * remove the watches of all rules starting at rule 'start',
+ * used when the rule set gets truncated. As the watches of a rule
+ * are always on the lists of w1 and w2, we only need to look
+ * at those lists.
+ */
+
+static void
+truncatewatches(Solver *solv, Id start)
+{
+  int nsolvables = solv->pool->nsolvables;
+  Watchlist *watches = solv->watches + nsolvables;
+  Watchlist *binwatches = solv->binwatches + nsolvables;
+  Rule *r;
+  Id i;
 
-  r->n2 = solv->watches[nsolvables + r->w2];
-  solv->watches[nsolvables + r->w2] = r - solv->rules;
+  for (i = start, r = solv->rules + i; i < solv->nrules; i++, r++)
+    {
+      if (!r->w2)		/* no watches */
+	continue;
+      if (r->d == 0 || r->d == -1)
+	{
+	  truncatewatchlist(solv, binwatches + r->w1, 1, start);
+	  truncatewatchlist(solv, binwatches + r->w2, 1, start);
+	}
+      else
+	{
+	  truncatewatchlist(solv, watches + r->w1, 0, start);
+	  truncatewatchlist(solv, watches + r->w2, 0, start);
+	}
+    }
 }
 
 
@@ -497,22 +677,30 @@ addwatches_rule(Solver *solv, Rule *r)
  * 
  * Everything's fixed there, it's just finding rules that are
  * unit.
+ *
+ * Binary rules live in their own watch lists (binwatches), they
+ * just imply the other literal and never need to move a watch.
  * 
  * return : 0 = everything is OK
  *          rule = conflict found in this rule
  */
 
 static Rule *
-propagate(Solver *solv, int level)
+dopropagate(Solver *solv, int level)
 {
   Pool *pool = solv->pool;
-  Id *rp, *next_rp;           /* rule pointer, next rule pointer in linked list */
+  Watchlist *wl;              /* watch list of 'pkg' */
+  int wp, wstart, wend;       /* current watcher, list boundaries */
+  int wkeep;                  /* kept watchers get compacted to the end of the list */
+  Id *wd;                     /* solv->watchdata, addwatch() may move it */
   Rule *r;                    /* rule */
+  Id rid, blocker;
   Id p, pkg, other_watch;
   Id *dp;
   Id *decisionmap = solv->decisionmap;
     
-  Id *watches = solv->watches + pool->nsolvables;   /* place ptr in middle */
+  Watchlist *watches = solv->watches + pool->nsolvables;   /* place ptr in middle */
+  Watchlist *binwatches = solv->binwatches + pool->nsolvables;
 
   POOL_DEBUG(SAT_DEBUG_PROPAGATE, "----- propagate -----\n");
 
@@ -524,6 +712,7 @@ propagate(Solver *solv, int level)
 	 * negate because our watches trigger if literal goes FALSE
 	 */
       pkg = -solv->decisionq.elements[solv->propagate_index++];
+      solv->stats.propagations++;
 	
       IF_POOLDEBUG (SAT_DEBUG_PROPAGATE)
         {
@@ -531,17 +720,35 @@ propagate(Solver *solv, int level)
 	  solver_printruleelement(solv, SAT_DEBUG_PROPAGATE, 0, -pkg);
         }
 
-      /* foreach rule where 'pkg' is now FALSE */
-      for (rp = watches + pkg; *rp; rp = next_rp)
+      wl = watches + pkg;
+      wd = solv->watchdata;
+      wstart = wl->off;
+      wend = wkeep = wstart + wl->count;
+
+      /* foreach rule where 'pkg' is now FALSE, newest first */
+      for (wp = wend; wp > wstart; )
 	{
-	  r = solv->rules + *rp;
+	  wp -= 2;
+	  rid = wd[wp];
+	  blocker = wd[wp + 1];
+
+	    /*
+	     * The rule is already true (through the blocker)
+	     * so we do not even need to look at it
+	     */
+	  if (DECISIONMAP_TRUE(blocker))
+	    {
+	      wd[--wkeep] = blocker;
+	      wd[--wkeep] = rid;
+	      continue;
+	    }
+
+	  r = solv->rules + rid;
 	  if (r->d < 0)
 	    {
 	      /* rule is disabled, goto next */
-	      if (pkg == r->w1)
-	        next_rp = &r->n1;
-	      else
-	        next_rp = &r->n2;
+	      wd[--wkeep] = blocker;
+	      wd[--wkeep] = rid;
 	      continue;
 	    }
 
@@ -554,25 +761,19 @@ propagate(Solver *solv, int level)
 	    /* 'pkg' was just decided (was set to FALSE)
 	     * 
 	     *  now find other literal watch, check clause
-	     *   and advance on linked list
 	     */
-	  if (pkg == r->w1)
-	    {
-	      other_watch = r->w2;
-	      next_rp = &r->n1;
-	    }
-	  else
-	    {
-	      other_watch = r->w1;
-	      next_rp = &r->n2;
-	    }
+	  other_watch = pkg == r->w1 ? r->w2 : r->w1;
 	    
 	    /* 
 	     * This term is already true (through the other literal)
-	     * so we have nothing to do
+	     * so we have nothing to do but to remember it as blocker
 	     */
 	  if (DECISIONMAP_TRUE(other_watch))
-	    continue;
+	    {
+	      wd[--wkeep] = other_watch;
+	      wd[--wkeep] = rid;
+	      continue;
+	    }
 
 	    /*
 	     * The other literal is FALSE or UNDEF
@@ -600,7 +801,7 @@ propagate(Solver *solv, int level)
 		  /* foreach p in 'd'
 		     we just iterate sequentially, doing it in another order just changes the order of decisions, not the decisions itself
 		   */
-		  for (dp = pool->whatprovidesdata + r->d; (p = *dp++) != 0;)
+		  for (dp = solver_whatprovidesdata(solv, r->d); (p = *dp++) != 0;)
 		    {
 		      if (p != other_watch              /* which is not watched */
 		          && !DECISIONMAP_FALSE(p))     /* and not FALSE */
@@ -612,7 +813,8 @@ propagate(Solver *solv, int level)
 		{
 		  /*
 		   * if we found some p that is UNDEF or TRUE, move
-		   * watch to it
+		   * watch to it. p is not FALSE, so its watch list
+		   * is not the one we are walking.
 		   */
 		  IF_POOLDEBUG (SAT_DEBUG_PROPAGATE)
 		    {
@@ -622,32 +824,35 @@ propagate(Solver *solv, int level)
 			POOL_DEBUG(SAT_DEBUG_PROPAGATE,"    -> move w%d to !%s\n", (pkg == r->w1 ? 1 : 2), solvid2str(pool, -p));
 		    }
 		    
-		  *rp = *next_rp;
-		  next_rp = rp;
-		    
 		  if (pkg == r->w1)
-		    {
-		      r->w1 = p;
-		      r->n1 = watches[p];
-		    }
+		    r->w1 = p;
 		  else
-		    {
-		      r->w2 = p;
-		      r->n2 = watches[p];
-		    }
-		  watches[p] = r - solv->rules;
+		    r->w2 = p;
+		  addwatch(solv, watches + p, rid, other_watch);
+		  wd = solv->watchdata;
 		  continue;
 		}
 	      /* search failed, thus all unwatched literals are FALSE */
 		
 	    } /* not binary */
 	    
+	  wd[--wkeep] = other_watch;
+	  wd[--wkeep] = rid;
+
             /*
 	     * unit clause found, set literal other_watch to TRUE
 	     */
 
 	  if (DECISIONMAP_FALSE(other_watch))	   /* check if literal is FALSE */
-	    return r;  		                   /* eek, a conflict! */
+	    {
+	      /* eek, a conflict! keep the watchers we did not look at */
+	      solv->stats.watchvisits += (wend - wp) / 2;
+	      if (wkeep != wp)
+		memmove(wd + wp, wd + wkeep, (wend - wkeep) * sizeof(Id));
+	      wl->left += wkeep - wp;
+	      wl->count -= wkeep - wp;
+	      return r;
+	    }
 	    
 	  IF_POOLDEBUG (SAT_DEBUG_PROPAGATE)
 	    {
@@ -661,7 +866,7 @@ propagate(Solver *solv, int level)
 	    decisionmap[-other_watch] = -level;  /* remove! */
 	    
 	  queue_push(&solv->decisionq, other_watch);
-	  queue_push(&solv->decisionq_why, r - solv->rules);
+	  queue_push(&solv->decisionq_why, rid);
 
 	  IF_POOLDEBUG (SAT_DEBUG_PROPAGATE)
 	    {
@@ -672,6 +877,49 @@ propagate(Solver *solv, int level)
 	    }
 	    
 	} /* foreach rule involving 'pkg' */
+
+      solv->stats.watchvisits += (wend - wstart) / 2;
+
+      /* move the kept watchers to the front */
+      if (wkeep != wstart)
+	memmove(wd + wstart, wd + wkeep, (wend - wkeep) * sizeof(Id));
+      wl->left += wkeep - wstart;
+      wl->count -= wkeep - wstart;
+
+      /*
+       * binary rules: the other literal is implied, no watch
+       * needs to move
+       */
+      wl = binwatches + pkg;
+      wd = solv->watchdata;
+      for (wstart = wl->off, wp = wstart + wl->count; wp > wstart; )
+	{
+	  wp -= 2;
+	  p = wd[wp];			/* the implied literal */
+	  if (DECISIONMAP_TRUE(p))
+	    continue;
+	  rid = wd[wp + 1];
+	  r = solv->rules + rid;
+	  if (r->d < 0)
+	    continue;			/* rule is disabled */
+	  if (DECISIONMAP_FALSE(p))
+	    {
+	      solv->stats.watchvisits += (wl->off + wl->count - wp) / 2;
+	      return r;			/* eek, a conflict! */
+	    }
+	  IF_POOLDEBUG (SAT_DEBUG_PROPAGATE)
+	    {
+	      POOL_DEBUG(SAT_DEBUG_PROPAGATE, "   unit ");
+	      solver_printrule(solv, SAT_DEBUG_PROPAGATE, r);
+	    }
+	  if (p > 0)
+	    decisionmap[p] = level;	/* install! */
+	  else
+	    decisionmap[-p] = -level;	/* remove! */
+	  queue_push(&solv->decisionq, p);
+	  queue_push(&solv->decisionq_why, rid);
+	}
+      solv->stats.watchvisits += wl->count / 2;
 	
     } /* while we have non-decided decisions */
     
@@ -681,9 +929,206 @@ propagate(Solver *solv, int level)
 }
 
 
+/* dopropagate with accounting for the statistics. Taking the time
+ * costs two system calls per propagation, so it is only done if the
+ * statistics get logged */
+static Rule *
+propagate(Solver *solv, int level)
+{
+  Pool *pool = solv->pool;
+  unsigned int now;
+  Rule *r;
+
+  IF_POOLDEBUG (SAT_DEBUG_STATS)
+    {
+      now = sat_timeus(0);
+      r = dopropagate(solv, level);
+      solv->stats.time_propagate += sat_timeus(now);
+    }
+  else
+    r = dopropagate(solv, level);
+  if (r)
+    solv->stats.conflicts++;
+  return r;
+}
+
+
 /********************************************************************/
 /* Analysis */
 
+/*-------------------------------------------------------------------
+ * 
+ * analyze_implied
+ *
+ * check if the decision of vv is implied by the literals marked in
+ * the seen map, by following the rules that decided it. Literals
+ * decided at level 1 are fine, they get resolved in the level 1 pass.
+ * The solvables found on the way are marked in seen and added to
+ * 'implied', so that later checks can stop there.
+ * On failure, the marks made by this check are undone.
+ */
+
+static int
+analyze_implied(Solver *solv, Id vv, int minlevel, unsigned int levels, Queue *stack, Queue *implied)
+{
+  Map *seen = &solv->analyze_seen;
+  Id *decisionmap = solv->decisionmap;
+  Id *whys = solv->analyze_whys;
+  int i, l, oldcount = implied->count;
+  Id d, v, *dp;
+  Rule *c;
+
+  queue_empty(stack);
+  queue_push(stack, vv);
+  while (stack->count)
+    {
+      c = solv->rules + whys[queue_pop(stack)];
+      d = c->d < 0 ? -c->d - 1 : c->d;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
+      for (i = -1; ; i++)
+	{
+	  if (i == -1)
+	    v = c->p;
+	  else if (d == 0)
+	    v = i ? 0 : c->w2;
+	  else
+	    v = *dp++;
+	  if (v == 0)
+	    break;
+	  if (DECISIONMAP_TRUE(v))	/* the literal that got decided */
+	    continue;
+	  v = v > 0 ? v : -v;
+	  if (MAPTST(seen, v))
+	    continue;
+	  l = decisionmap[v];
+	  if (l < 0)
+	    l = -l;
+	  if (l == 1)
+	    continue;
+	  if (l < minlevel || !(levels & (1U << (l & 31))) || whys[v] <= 0)
+	    {
+	      /* not implied, undo our marks */
+	      for (i = oldcount; i < implied->count; i++)
+		MAPCLR(seen, implied->elements[i]);
+	      implied->count = oldcount;
+	      return 0;
+	    }
+	  MAPSET(seen, v);
+	  queue_push(stack, v);
+	  queue_push(implied, v);
+	}
+    }
+  return 1;
+}
+
+/*-------------------------------------------------------------------
+ * 
+ * analyze_minimize
+ *
+ * drop the literals of the learnt rule 'r' that are implied by
+ * the other literals. The rules used for this are added to the
+ * proof in learnt_pool, the level 1 literals they contain are
+ * marked in the seen map.
+ *
+ * idx is the decisionq index of the UIP, all literals of 'r'
+ * were decided before it.
+ *
+ * returns the number of new level 1 literals marked in 'seen'
+ */
+
+static int
+analyze_minimize(Solver *solv, Queue *r, int idx)
+{
+  Pool *pool = solv->pool;
+  Map *seen = &solv->analyze_seen;
+  Id *decisionmap = solv->decisionmap;
+  Queue stack, implied;
+  Id stack_buf[16], implied_buf[16];
+  Id v, vv, d, *dp;
+  Rule *c;
+  int i, j, l, minlevel = 0, l1new = 0;
+  unsigned int levels = 0;
+
+  for (i = 0; i < r->count; i++)
+    {
+      v = r->elements[i];
+      l = decisionmap[v > 0 ? v : -v];
+      if (l < 0)
+	l = -l;
+      if (!minlevel || l < minlevel)
+	minlevel = l;
+      levels |= 1U << (l & 31);
+    }
+  /* remember why the decisions down to minlevel were made */
+  if (!solv->analyze_whys)
+    solv->analyze_whys = sat_malloc2(pool->nsolvables, sizeof(Id));
+  while (idx > 0)
+    {
+      v = solv->decisionq.elements[--idx];
+      vv = v > 0 ? v : -v;
+      l = decisionmap[vv];
+      if ((l < 0 ? -l : l) < minlevel)
+	break;
+      solv->analyze_whys[vv] = solv->decisionq_why.elements[idx];
+    }
+
+  queue_init_buffer(&stack, stack_buf, sizeof(stack_buf)/sizeof(*stack_buf));
+  queue_init_buffer(&implied, implied_buf, sizeof(implied_buf)/sizeof(*implied_buf));
+  for (i = j = 0; i < r->count; i++)
+    {
+      v = r->elements[i];
+      vv = v > 0 ? v : -v;
+      if (solv->analyze_whys[vv] <= 0 || !analyze_implied(solv, vv, minlevel, levels, &stack, &implied))
+	{
+	  r->elements[j++] = v;
+	  continue;
+	}
+      queue_push(&implied, vv);
+    }
+  if (j == r->count)
+    {
+      queue_free(&stack);
+      queue_free(&implied);
+      return 0;
+    }
+  POOL_DEBUG(SAT_DEBUG_ANALYZE, "minimized learnt rule by %d literals\n", r->count - j);
+  r->count = j;
+
+  /* add the rules we used to the proof */
+  for (i = 0; i < implied.count; i++)
+    {
+      vv = implied.elements[i];
+      queue_push(&solv->learnt_pool, solv->analyze_whys[vv]);
+      c = solv->rules + solv->analyze_whys[vv];
+      d = c->d < 0 ? -c->d - 1 : c->d;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
+      for (j = -1; ; j++)
+	{
+	  if (j == -1)
+	    v = c->p;
+	  else if (d == 0)
+	    v = j ? 0 : c->w2;
+	  else
+	    v = *dp++;
+	  if (v == 0)
+	    break;
+	  v = v > 0 ? v : -v;
+	  if ((decisionmap[v] == 1 || decisionmap[v] == -1) && !MAPTST(seen, v))
+	    {
+	      MAPSET(seen, v);
+	      l1new++;
+	    }
+	}
+    }
+  /* only the level 1 literals and the literals of 'r' stay marked */
+  for (i = 0; i < implied.count; i++)
+    MAPCLR(seen, implied.elements[i]);
+  queue_free(&stack);
+  queue_free(&implied);
+  return l1new;
+}
+
+
 /*-------------------------------------------------------------------
  * 
  * analyze
@@ -691,13 +1136,13 @@ propagate(Solver *solv, int level)
  */
 
 static int
-analyze(Solver *solv, int level, Rule *c, int *pr, int *dr, int *whyp)
+analyze(Solver *solv, int level, Rule *c, int *pr, int *dr, int *whyp, int *lbdp)
 {
   Pool *pool = solv->pool;
   Queue r;
   Id r_buf[4];
   int rlevel = 1;
-  Map seen;		/* global? */
+  Map *seen = &solv->analyze_seen;	/* all clear between calls */
   Id d, v, vv, *dp, why;
   int l, i, idx;
   int num = 0, l1num = 0;
@@ -707,7 +1152,8 @@ analyze(Solver *solv, int level, Rule *c, int *pr, int *dr, int *whyp)
   queue_init_buffer(&r, r_buf, sizeof(r_buf)/sizeof(*r_buf));
 
   POOL_DEBUG(SAT_DEBUG_ANALYZE, "ANALYZE at %d ----------------------\n", level);
-  map_init(&seen, pool->nsolvables);
+  if (!seen->size)
+    map_init(seen, pool->nsolvables);
   idx = solv->decisionq.count;
   for (;;)
     {
@@ -715,7 +1161,7 @@ analyze(Solver *solv, int level, Rule *c, int *pr, int *dr, int *whyp)
 	solver_printruleclass(solv, SAT_DEBUG_ANALYZE, c);
       queue_push(&solv->learnt_pool, c - solv->rules);
       d = c->d < 0 ? -c->d - 1 : c->d;
-      dp = d ? pool->whatprovidesdata + d : 0;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
       /* go through all literals of the rule */
       for (i = -1; ; i++)
 	{
@@ -731,12 +1177,12 @@ analyze(Solver *solv, int level, Rule *c, int *pr, int *dr, int *whyp)
 	  if (DECISIONMAP_TRUE(v))	/* the one true literal */
 	    continue;
 	  vv = v > 0 ? v : -v;
-	  if (MAPTST(&seen, vv))
+	  if (MAPTST(seen, vv))
 	    continue;
 	  l = solv->decisionmap[vv];
 	  if (l < 0)
 	    l = -l;
-	  MAPSET(&seen, vv);		/* mark that we also need to look at this literal */
+	  MAPSET(seen, vv);		/* mark that we also need to look at this literal */
 	  if (l == 1)
 	    l1num++;			/* need to do this one in level1 pass */
 	  else if (l == level)
@@ -759,14 +1205,27 @@ l1retry:
 	  assert(idx > 0);
 	  v = solv->decisionq.elements[--idx];
 	  vv = v > 0 ? v : -v;
-	  if (MAPTST(&seen, vv))
+	  if (MAPTST(seen, vv))
 	    break;
 	}
-      MAPCLR(&seen, vv);
+      MAPCLR(seen, vv);
 
       if (num && --num == 0)
 	{
 	  *pr = -v;	/* so that v doesn't get lost */
+	  if (r.count)
+	    {
+	      l1num += analyze_minimize(solv, &r, idx);
+	      for (rlevel = 1, i = 0; i < r.count; i++)
+		{
+		  v = r.elements[i];
+		  l = decisionmap[v > 0 ? v : -v];
+		  if (l < 0)
+		    l = -l;
+		  if (l > rlevel)
+		    rlevel = l;
+		}
+	    }
 	  if (!l1num)
 	    break;
 	  POOL_DEBUG(SAT_DEBUG_ANALYZE, "got %d involved level 1 decisions\n", l1num);
@@ -774,7 +1233,7 @@ l1retry:
 	  for (i = 0; i < r.count; i++)
 	    {
 	      v = r.elements[i];
-	      MAPCLR(&seen, v > 0 ? v : -v);
+	      MAPCLR(seen, v > 0 ? v : -v);
 	    }
 	  /* only level 1 marks left in seen map */
 	  l1num++;	/* as l1retry decrements it */
@@ -786,14 +1245,42 @@ l1retry:
 	goto l1retry;
       c = solv->rules + why;
     }
-  map_free(&seen);
+  /* only literals of the new rule can be left in the map */
+  for (i = 0; i < r.count; i++)
+    {
+      v = r.elements[i];
+      MAPCLR(seen, v > 0 ? v : -v);
+    }
+
+  /* literal block distance: the number of different levels in the
+   * new rule. There are less levels than solvables, so we can borrow
+   * the seen map */
+  *lbdp = 1;		/* the conflict level */
+  for (i = 0; i < r.count; i++)
+    {
+      v = r.elements[i];
+      l = decisionmap[v > 0 ? v : -v];
+      if (l < 0)
+	l = -l;
+      if (!MAPTST(seen, l))
+	{
+	  MAPSET(seen, l);
+	  (*lbdp)++;
+	}
+    }
+  for (i = 0; i < r.count; i++)
+    {
+      v = r.elements[i];
+      l = decisionmap[v > 0 ? v : -v];
+      MAPCLR(seen, l < 0 ? -l : l);
+    }
 
   if (r.count == 0)
     *dr = 0;
   else if (r.count == 1 && r.elements[0] < 0)
     *dr = r.elements[0];
   else
-    *dr = pool_queuetowhatprovides(pool, &r);
+    *dr = solver_queuetowhatprovides(solv, &r);
   IF_POOLDEBUG (SAT_DEBUG_ANALYZE)
     {
       POOL_DEBUG(SAT_DEBUG_ANALYZE, "learned rule for level %d (am %d)\n", rlevel, level);
@@ -832,12 +1319,12 @@ solver_reset(Solver *solv)
       v = solv->decisionq.elements[i];
       solv->decisionmap[v > 0 ? v : -v] = 0;
     }
-  solv->decisionq_why.count = 0;
-  solv->decisionq.count = 0;
+  queue_empty(&solv->decisionq_why);
+  queue_empty(&solv->decisionq);
   solv->recommends_index = -1;
   solv->propagate_index = 0;
-  solv->recommendations.count = 0;
-  solv->branches.count = 0;
+  queue_empty(&solv->recommendations);
+  queue_empty(&solv->branches);
 
   /* adapt learnt rule status to new set of enabled/disabled rules */
   enabledisablelearntrules(solv);
@@ -930,6 +1417,7 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
   int oldlearntpoolcount;
   Id lastweak;
   int record_proof = 1;
+  size_t scratchmark;
 
   POOL_DEBUG(SAT_DEBUG_UNSOLVABLE, "ANALYZE UNSOLVABLE ----------------------\n");
   solv->stats_unsolvable++;
@@ -942,14 +1430,15 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
   queue_push(&solv->problems, 0);
 
   r = cr;
-  map_init(&seen, pool->nsolvables);
-  map_init(&rseen, solv->learntrules ? solv->nrules - solv->learntrules : 0);
+  scratchmark = scratch_mark(&solv->scratch);
+  scratch_map_init(&solv->scratch, &seen, pool->nsolvables);
+  scratch_map_init(&solv->scratch, &rseen, solv->learntrules ? solv->nrules - solv->learntrules : 0);
   if (record_proof)
     queue_push(&solv->learnt_pool, r - solv->rules);
   lastweak = 0;
   analyze_unsolvable_rule(solv, r, &lastweak, &rseen);
   d = r->d < 0 ? -r->d - 1 : r->d;
-  dp = d ? pool->whatprovidesdata + d : 0;
+  dp = d ? solver_whatprovidesdata(solv, d) : 0;
   for (i = -1; ; i++)
     {
       if (i == -1)
@@ -982,7 +1471,7 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
       r = solv->rules + why;
       analyze_unsolvable_rule(solv, r, &lastweak, &rseen);
       d = r->d < 0 ? -r->d - 1 : r->d;
-      dp = d ? pool->whatprovidesdata + d : 0;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
       for (i = -1; ; i++)
 	{
 	  if (i == -1)
@@ -1002,8 +1491,7 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
 	  MAPSET(&seen, vv);
 	}
     }
-  map_free(&seen);
-  map_free(&rseen);
+  scratch_release(&solv->scratch, scratchmark);
   queue_push(&solv->problems, 0);	/* mark end of this problem */
 
   if (lastweak)
@@ -1024,6 +1512,7 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
       if (v < 0)
 	solver_reenablepolicyrules(solv, -(v + 1));
       solver_reset(solv);
+      solv->stats.restarts++;
       return 1;
     }
 
@@ -1040,6 +1529,7 @@ analyze_unsolvable(Solver *solv, Rule *cr, int disablerules)
         solver_disableproblem(solv, solv->problems.elements[i]);
       /* XXX: might want to enable all weak rules again */
       solver_reset(solv);
+      solv->stats.restarts++;
       return 1;
     }
   POOL_DEBUG(SAT_DEBUG_UNSOLVABLE, "UNSOLVABLE\n");
@@ -1068,20 +1558,21 @@ revert(Solver *solv, int level)
       if (solv->decisionmap[vv] <= level && solv->decisionmap[vv] >= -level)
         break;
       POOL_DEBUG(SAT_DEBUG_PROPAGATE, "reverting decision %d at %d\n", v, solv->decisionmap[vv]);
+      if (solv->recommends_index == solv->decisionq.count)
+	policy_revert_recommendsmap(solv);
       if (v > 0 && solv->recommendations.count && v == solv->recommendations.elements[solv->recommendations.count - 1])
-	solv->recommendations.count--;
+	queue_pop(&solv->recommendations);
       solv->decisionmap[vv] = 0;
-      solv->decisionq.count--;
-      solv->decisionq_why.count--;
+      queue_pop(&solv->decisionq);
+      queue_pop(&solv->decisionq_why);
       solv->propagate_index = solv->decisionq.count;
     }
   while (solv->branches.count && solv->branches.elements[solv->branches.count - 1] <= -level)
     {
-      solv->branches.count--;
+      queue_pop(&solv->branches);
       while (solv->branches.count && solv->branches.elements[solv->branches.count - 1] >= 0)
-	solv->branches.count--;
+	queue_pop(&solv->branches);
     }
-  solv->recommends_index = -1;
 }
 
 
@@ -1099,7 +1590,7 @@ watch2onhighest(Solver *solv, Rule *r)
   d = r->d < 0 ? -r->d - 1 : r->d;
   if (!d)
     return;	/* binary rule, both watches are set */
-  dp = solv->pool->whatprovidesdata + d;
+  dp = solver_whatprovidesdata(solv, d);
   while ((v = *dp++) != 0)
     {
       l = solv->decisionmap[v < 0 ? -v : v];
@@ -1116,32 +1607,119 @@ watch2onhighest(Solver *solv, Rule *r)
 
 /*-------------------------------------------------------------------
  * 
- * setpropagatelearn
- *
- * add free decision (solvable to install) to decisionq
- * increase level and propagate decision
- * return if no conflict.
+ * reducelearntrules
  *
- * in conflict case, analyze conflict rule, add resulting
- * rule to learnt rule set, make decision from learnt
- * rule (always unit) and re-propagate.
- *
- * returns the new solver level or 0 if unsolvable
+ * delete half of the learnt rules that are not binary, not an
+ * assertion, not the reason for a decision and have a literal
+ * block distance > 2. The ones with the highest distance go first,
+ * older ones before younger ones.
  *
+ * A deleted rule keeps its place and its proof in learnt_pool, as
+ * other learnt rules may have been derived from it. It gets
+ * w1 = w2 = 0 and is removed from the watch lists.
  */
 
 static int
-setpropagatelearn(Solver *solv, int level, Id decision, int disablerules, Id ruleid)
+reducelearntrules_sortcmp(const void *ap, const void *bp, void *dp)
+{
+  Solver *solv = dp;
+  Id a = *(Id *)ap;
+  Id b = *(Id *)bp;
+  Id *lbd = solv->learnt_lbd.elements - solv->learntrules;
+
+  if (lbd[a] != lbd[b])
+    return lbd[b] - lbd[a];
+  return a - b;
+}
+
+static void
+reducelearntrules(Solver *solv)
 {
   Pool *pool = solv->pool;
+  Id *lbd = solv->learnt_lbd.elements - solv->learntrules;
+  Queue q;
+  Map locked;
   Rule *r;
-  Id p = 0, d = 0;
-  int l, why;
+  Watchlist *wl;
+  Id rid, *wp, *wq, *wend;
+  int i, n;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
-  assert(ruleid >= 0);
-  if (decision)
+  /* rules that are the reason for a decision must stay */
+  scratch_map_init(&solv->scratch, &locked, solv->nrules - solv->learntrules);
+  for (i = 0; i < solv->decisionq_why.count; i++)
     {
-      level++;
+      rid = solv->decisionq_why.elements[i];
+      if (rid >= solv->learntrules)
+	MAPSET(&locked, rid - solv->learntrules);
+    }
+  scratch_queue_init(&solv->scratch, &q, solv->nrules - solv->learntrules);
+  for (rid = solv->learntrules, r = solv->rules + rid; rid < solv->nrules; rid++, r++)
+    {
+      if (!r->w1 || r->d == 0 || r->d == -1)
+	continue;		/* deleted, binary or assertion */
+      if (lbd[rid] > 2 && !MAPTST(&locked, rid - solv->learntrules))
+	queue_push(&q, rid);
+    }
+  sat_sort(q.elements, q.count, sizeof(Id), reducelearntrules_sortcmp, solv);
+  n = q.count / 2;
+  for (i = 0; i < n; i++)
+    {
+      r = solv->rules + q.elements[i];
+      r->w1 = r->w2 = 0;
+    }
+  queue_free(&q);
+  scratch_release(&solv->scratch, scratchmark);
+  solv->stats_learned_deleted += n;
+  POOL_DEBUG(SAT_DEBUG_STATS, "reduced learnt rules: %d deleted, %d kept\n", n, solv->nrules - solv->learntrules - solv->stats_learned_deleted);
+  if (!n)
+    return;
+
+  /* drop the deleted rules from the watch lists, keeping the order */
+  for (i = 0, wl = solv->watches; i < 2 * pool->nsolvables; i++, wl++)
+    {
+      wp = wq = solv->watchdata + wl->off;
+      for (wend = wp + wl->count; wp < wend; wp += 2)
+	if (solv->rules[*wp].w1)
+	  {
+	    *wq++ = wp[0];
+	    *wq++ = wp[1];
+	  }
+      wl->left += wend - wq;
+      wl->count -= wend - wq;
+    }
+}
+
+
+/*-------------------------------------------------------------------
+ * 
+ * setpropagatelearn
+ *
+ * add free decision (solvable to install) to decisionq
+ * increase level and propagate decision
+ * return if no conflict.
+ *
+ * in conflict case, analyze conflict rule, add resulting
+ * rule to learnt rule set, make decision from learnt
+ * rule (always unit) and re-propagate.
+ *
+ * returns the new solver level or 0 if unsolvable
+ *
+ */
+
+static int
+setpropagatelearn(Solver *solv, int level, Id decision, int disablerules, Id ruleid)
+{
+  Pool *pool = solv->pool;
+  Rule *r;
+  Id p = 0, d = 0;
+  int l, why, lbd;
+
+  assert(ruleid >= 0);
+  if (decision)
+    {
+      solv->stats.branches++;
+      level++;
       if (decision > 0)
         solv->decisionmap[decision] = level;
       else
@@ -1157,7 +1735,7 @@ setpropagatelearn(Solver *solv, int level, Id decision, int disablerules, Id rul
       if (level == 1)
 	return analyze_unsolvable(solv, r, disablerules);
       POOL_DEBUG(SAT_DEBUG_ANALYZE, "conflict with rule #%d\n", (int)(r - solv->rules));
-      l = analyze(solv, level, r, &p, &d, &why);	/* learnt rule in p and d */
+      l = analyze(solv, level, r, &p, &d, &why, &lbd);	/* learnt rule in p and d */
       assert(l > 0 && l < level);
       POOL_DEBUG(SAT_DEBUG_ANALYZE, "reverting decisions (level %d -> %d)\n", level, l);
       level = l;
@@ -1166,6 +1744,7 @@ setpropagatelearn(Solver *solv, int level, Id decision, int disablerules, Id rul
       assert(r);
       assert(solv->learnt_why.count == (r - solv->rules) - solv->learntrules);
       queue_push(&solv->learnt_why, why);
+      queue_push(&solv->learnt_lbd, lbd);
       if (d)
 	{
 	  /* at least 2 literals, needs watches */
@@ -1188,6 +1767,11 @@ setpropagatelearn(Solver *solv, int level, Id decision, int disablerules, Id rul
 	  POOL_DEBUG(SAT_DEBUG_ANALYZE, "new rule: ");
 	  solver_printrule(solv, SAT_DEBUG_ANALYZE, r);
 	}
+      if (solv->nrules - solv->learntrules - solv->stats_learned_deleted >= solv->learnt_reduce_limit)
+	{
+	  reducelearntrules(solv);
+	  solv->learnt_reduce_limit += LEARNT_REDUCE_INC;
+	}
     }
   return level;
 }
@@ -1223,7 +1807,7 @@ selectandinstall(Solver *solv, int level, Queue *dq, int disablerules, Id ruleid
 	if (solver_is_supplementing(solv, pool->solvables + dq->elements[i]))
 	  {
 	    dq->elements[0] = dq->elements[i];
-	    dq->count = 1;
+	    queue_truncate(dq, 1);
 	    break;
 	  }
     }
@@ -1277,10 +1861,12 @@ solver_create(Pool *pool)
   queue_init(&solv->orphaned);
   queue_init(&solv->learnt_why);
   queue_init(&solv->learnt_pool);
+  queue_init(&solv->learnt_lbd);
   queue_init(&solv->branches);
   queue_init(&solv->covenantq);
   queue_init(&solv->weakruleq);
   queue_init(&solv->ruleassertions);
+  scratch_init(&solv->scratch);
 
   queue_push(&solv->learnt_pool, 0);	/* so that 0 does not describe a proof */
 
@@ -1288,8 +1874,10 @@ solver_create(Pool *pool)
   map_init(&solv->suggestsmap, pool->nsolvables);
   map_init(&solv->noupdate, solv->installed ? solv->installed->end - solv->installed->start : 0);
   solv->recommends_index = 0;
+  solv->learnt_reduce_limit = LEARNT_REDUCE_START;
 
   solv->decisionmap = (Id *)sat_calloc(pool->nsolvables, sizeof(Id));
+  solv->nsolvables = pool->nsolvables;
   solv->nrules = 1;
   solv->rules = sat_extend_resize(solv->rules, solv->nrules, sizeof(Rule), RULES_BLOCK);
   memset(solv->rules, 0, sizeof(Rule));
@@ -1313,6 +1901,7 @@ solver_free(Solver *solv)
   queue_free(&solv->decisionq_why);
   queue_free(&solv->learnt_why);
   queue_free(&solv->learnt_pool);
+  queue_free(&solv->learnt_lbd);
   queue_free(&solv->problems);
   queue_free(&solv->solutions);
   queue_free(&solv->suggestions);
@@ -1325,6 +1914,10 @@ solver_free(Solver *solv)
 
   map_free(&solv->recommendsmap);
   map_free(&solv->suggestsmap);
+  sat_free(solv->recommendsrefs);
+  sat_free(solv->suggestsrefs);
+  map_free(&solv->analyze_seen);
+  sat_free(solv->analyze_whys);
   map_free(&solv->noupdate);
   map_free(&solv->weakrulemap);
   map_free(&solv->noobsoletes);
@@ -1335,18 +1928,108 @@ solver_free(Solver *solv)
   map_free(&solv->dupinvolvedmap);
   map_free(&solv->droporphanedmap);
   map_free(&solv->cleandepsmap);
+  map_free(&solv->rpmrulesmap);
 
+  sat_free(solv->rpmrules_base);
   sat_free(solv->decisionmap);
+  sat_free(solv->assumptions_ruleidx);
+  sat_free(solv->assumptions_ruledata);
+  sat_free(solv->whatprovidesauxdata);
   sat_free(solv->rules);
-  sat_free(solv->watches);
+  freewatches(solv);
   sat_free(solv->obsoletes);
   sat_free(solv->obsoletes_data);
   sat_free(solv->multiversionupdaters);
   sat_free(solv->choicerules_ref);
+  scratch_free(&solv->scratch);
   sat_free(solv);
 }
 
 
+/*-------------------------------------------------------------------
+ * 
+ * solve budget
+ *
+ * the limits are counted from the last solver_startbudget() call
+ */
+
+void
+solver_startbudget(Solver *solv)
+{
+  solv->budget_exhausted = 0;
+  solv->budget_start = sat_timems(0);
+  solv->budget_propagations = solv->stats.propagations;
+  solv->budget_conflicts = solv->stats.conflicts;
+}
+
+int
+solver_budgetexhausted(Solver *solv)
+{
+  Pool *pool = solv->pool;
+
+  if (solv->budget_exhausted)
+    return solv->budget_exhausted;
+  if (solv->maxpropagations && solv->stats.propagations - solv->budget_propagations >= solv->maxpropagations)
+    solv->budget_exhausted = SOLVER_BUDGET_PROPAGATIONS;
+  else if (solv->maxconflicts && solv->stats.conflicts - solv->budget_conflicts >= solv->maxconflicts)
+    solv->budget_exhausted = SOLVER_BUDGET_CONFLICTS;
+  else if (solv->maxsolvetime && sat_timems(solv->budget_start) >= solv->maxsolvetime)
+    solv->budget_exhausted = SOLVER_BUDGET_TIME;
+  else if (solv->cancel_callback && solv->cancel_callback(solv, solv->cancel_callback_data))
+    solv->budget_exhausted = SOLVER_BUDGET_CANCELLED;
+  if (solv->budget_exhausted)
+    POOL_DEBUG(SAT_DEBUG_STATS, "solver budget exhausted (%d)\n", solv->budget_exhausted);
+  return solv->budget_exhausted;
+}
+
+
+/*-------------------------------------------------------------------
+ *
+ * find the candidates for the recommends/supplements pass
+ *
+ * recq gets the installed packages with recommends, supq the
+ * undecided packages that supplement something an installed package
+ * provides. We look them up in the reverse supplements index of the
+ * pool, so the work depends on the number of decisions and not on
+ * the size of the pool. Both lists are sorted by solvable id, which
+ * is the order the old scan over all solvables used.
+ */
+
+static int
+findweakcandidates_sortcmp(const void *ap, const void *bp, void *dp)
+{
+  return *(const Id *)ap - *(const Id *)bp;
+}
+
+static void
+findweakcandidates(Solver *solv, Queue *recq, Queue *supq)
+{
+  Pool *pool = solv->pool;
+  Id p, *dp;
+  int i, j;
+
+  for (i = 0; i < solv->decisionq.count; i++)
+    {
+      p = solv->decisionq.elements[i];
+      if (p < 0)
+	continue;
+      if (pool->solvables[p].recommends)
+	queue_push(recq, p);
+      for (dp = pool_whatrequires_ptr(pool, p, SOLVABLE_SUPPLEMENTS); *dp; dp++)
+	if (!solv->decisionmap[*dp])
+	  queue_push(supq, *dp);
+    }
+  sat_sort(recq->elements, recq->count, sizeof(Id), findweakcandidates_sortcmp, 0);
+  if (supq->count < 2)
+    return;
+  sat_sort(supq->elements, supq->count, sizeof(Id), findweakcandidates_sortcmp, 0);
+  for (i = j = 1; i < supq->count; i++)
+    if (supq->elements[i] != supq->elements[j - 1])
+      supq->elements[j++] = supq->elements[i];
+  queue_truncate(supq, j);
+}
+
+
 /*-------------------------------------------------------------------
  * 
  * solver_run_sat
@@ -1355,8 +2038,8 @@ solver_free(Solver *solv)
  *
  */
 
-void
-solver_run_sat(Solver *solv, int disablerules, int doweak)
+static void
+run_sat(Solver *solv, int disablerules, int doweak)
 {
   Queue dq;		/* local decisionqueue */
   Queue dqs;		/* local decisionqueue for supplements */
@@ -1368,6 +2051,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
   Pool *pool = solv->pool;
   Id p, *dp;
   int minimizationsteps;
+  unsigned int minimizestart = 0;
   int installedpos = solv->installed ? solv->installed->start : 0;
 
   IF_POOLDEBUG (SAT_DEBUG_RULE_CREATION)
@@ -1387,8 +2071,8 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
   systemlevel = level + 1;
   POOL_DEBUG(SAT_DEBUG_SOLVER, "solving...\n");
 
-  queue_init(&dq);
-  queue_init(&dqs);
+  scratch_queue_init(&solv->scratch, &dq, 256);
+  scratch_queue_init(&solv->scratch, &dqs, 64);
 
   /*
    * here's the main loop:
@@ -1405,6 +2089,9 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
   minimizationsteps = 0;
   for (;;)
     {
+      if (solver_budgetexhausted(solv))
+	break;			/* out of budget, give up */
+
       /*
        * initial propagation of the assertions
        */
@@ -1468,7 +2155,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 			}
 		    }
 		  if (k)
-		    dq.count = k;
+		    queue_truncate(&dq, k);
 		}
 	      olevel = level;
 	      level = selectandinstall(solv, level, &dq, disablerules, i);
@@ -1538,7 +2225,8 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 			{
 			  /* special multiversion handling, make sure best version is chosen */
 			  queue_push(&dq, i);
-			  while ((p = pool->whatprovidesdata[d++]) != 0)
+			  dp = solver_whatprovidesdata(solv, d);
+			  while ((p = *dp++) != 0)
 			    if (solv->decisionmap[p] >= 0)
 			      queue_push(&dq, p);
 			  policy_filter_unwanted(solv, &dq, POLICY_MODE_CHOOSE);
@@ -1548,10 +2236,10 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 			      rr = solv->rules + solv->featurerules + (i - solv->installed->start);
 			      if (!rr->p)		/* update rule == feature rule? */
 				rr = rr - solv->featurerules + solv->updaterules;
-			      dq.count = 1;
+			      queue_truncate(&dq, 1);
 			    }
 			  else
-			    dq.count = 0;
+			    queue_empty(&dq);
 			}
 		      else
 			{
@@ -1560,7 +2248,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 			    {
 			      if (solv->decisionmap[p] > 0)
 				{
-				  dq.count = 0;		/* already fulfilled */
+				  queue_empty(&dq);		/* already fulfilled */
 				  break;
 				}
 			      if (!solv->decisionmap[p])
@@ -1646,7 +2334,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	  if (i == solv->nrules)
 	    i = 1;
 	  r = solv->rules + i;
-	  if (r->d < 0)		/* ignore disabled rules */
+	  if (r->d < 0 || !r->w1)	/* ignore disabled and deleted rules */
 	    continue;
 	  queue_empty(&dq);
 	  if (r->d == 0)
@@ -1680,7 +2368,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		  if (solv->decisionmap[r->p] == 0)
 		    queue_push(&dq, r->p);
 		}
-	      dp = pool->whatprovidesdata + r->d;
+	      dp = solver_whatprovidesdata(solv, r->d);
 	      while ((p = *dp++) != 0)
 		{
 		  if (p < 0)
@@ -1720,6 +2408,8 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	    break;		/* trouble */
 	  /* something changed, so look at all rules again */
 	  n = 0;
+	  if (solver_budgetexhausted(solv))
+	    break;		/* back to the main loop, which gives up */
 	}
 
       if (n != solv->nrules)	/* ran into trouble, restart */
@@ -1730,59 +2420,59 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
       if (doweak)
 	{
 	  int qcount;
+	  unsigned int weakstart = sat_timeus(0);
+	  Queue recq, supq;	/* candidates, see findweakcandidates() */
+	  size_t scratchmark = scratch_mark(&solv->scratch);
 
 	  POOL_DEBUG(SAT_DEBUG_POLICY, "installing recommended packages\n");
 	  queue_empty(&dq);	/* recommended packages */
 	  queue_empty(&dqs);	/* supplemented packages */
-	  for (i = 1; i < pool->nsolvables; i++)
+	  scratch_queue_init(&solv->scratch, &recq, 256);
+	  scratch_queue_init(&solv->scratch, &supq, 256);
+	  findweakcandidates(solv, &recq, &supq);
+	  for (i = 0; i < recq.count; i++)
 	    {
-	      if (solv->decisionmap[i] < 0)
+	      /* installed, check for recommends */
+	      Id *recp, rec, pp, p;
+	      s = pool->solvables + recq.elements[i];
+	      if (solv->ignorealreadyrecommended && s->repo == solv->installed)
 		continue;
-	      if (solv->decisionmap[i] > 0)
+	      /* XXX need to special case AND ? */
+	      recp = s->repo->idarraydata + s->recommends;
+	      while ((rec = *recp++) != 0)
 		{
-		  /* installed, check for recommends */
-		  Id *recp, rec, pp, p;
-		  s = pool->solvables + i;
-		  if (solv->ignorealreadyrecommended && s->repo == solv->installed)
-		    continue;
-		  /* XXX need to special case AND ? */
-		  if (s->recommends)
+		  qcount = dq.count;
+		  FOR_PROVIDES(p, pp, rec)
 		    {
-		      recp = s->repo->idarraydata + s->recommends;
-		      while ((rec = *recp++) != 0)
+		      if (solv->decisionmap[p] > 0)
 			{
-			  qcount = dq.count;
-			  FOR_PROVIDES(p, pp, rec)
-			    {
-			      if (solv->decisionmap[p] > 0)
-				{
-				  dq.count = qcount;
-				  break;
-				}
-			      else if (solv->decisionmap[p] == 0)
-				{
-				  if (solv->dupmap_all && solv->installed && pool->solvables[p].repo == solv->installed && (solv->droporphanedmap_all || (solv->droporphanedmap.size && MAPTST(&solv->droporphanedmap, p - solv->installed->start))))
-				    continue;
-				  queue_pushunique(&dq, p);
-				}
-			    }
+			  queue_truncate(&dq, qcount);
+			  break;
+			}
+		      else if (solv->decisionmap[p] == 0)
+			{
+			  if (solv->dupmap_all && solv->installed && pool->solvables[p].repo == solv->installed && (solv->droporphanedmap_all || (solv->droporphanedmap.size && MAPTST(&solv->droporphanedmap, p - solv->installed->start))))
+			    continue;
+			  queue_pushunique(&dq, p);
 			}
 		    }
 		}
-	      else
-		{
-		  s = pool->solvables + i;
-		  if (!s->supplements)
-		    continue;
-		  if (!pool_installable(pool, s))
-		    continue;
-		  if (!solver_is_supplementing(solv, s))
-		    continue;
-		  if (solv->dupmap_all && solv->installed && s->repo == solv->installed && (solv->droporphanedmap_all || (solv->droporphanedmap.size && MAPTST(&solv->droporphanedmap, i - solv->installed->start))))
-		    continue;
-		  queue_push(&dqs, i);
-		}
 	    }
+	  for (i = 0; i < supq.count; i++)
+	    {
+	      p = supq.elements[i];
+	      s = pool->solvables + p;
+	      if (!pool_installable(pool, s))
+		continue;
+	      if (!solver_is_supplementing(solv, s))
+		continue;
+	      if (solv->dupmap_all && solv->installed && s->repo == solv->installed && (solv->droporphanedmap_all || (solv->droporphanedmap.size && MAPTST(&solv->droporphanedmap, p - solv->installed->start))))
+		continue;
+	      queue_push(&dqs, p);
+	    }
+	  queue_free(&recq);
+	  queue_free(&supq);
+	  scratch_release(&solv->scratch, scratchmark);
 
 	  /* filter out all packages obsoleted by installed packages */
 	  /* this is no longer needed if we have reverse obsoletes */
@@ -1790,8 +2480,9 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	    {
 	      Map obsmap;
 	      Id obs, *obsp, po, ppo;
+	      size_t scratchmark = scratch_mark(&solv->scratch);
 
-	      map_init(&obsmap, pool->nsolvables);
+	      scratch_map_init(&solv->scratch, &obsmap, pool->nsolvables);
 	      for (p = solv->installed->start; p < solv->installed->end; p++)
 		{
 		  s = pool->solvables + p;
@@ -1810,12 +2501,12 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	      for (i = j = 0; i < dqs.count; i++)
 		if (!MAPTST(&obsmap, dqs.elements[i]))
 		  dqs.elements[j++] = dqs.elements[i];
-	      dqs.count = j;
+	      queue_truncate(&dqs, j);
 	      for (i = j = 0; i < dq.count; i++)
 		if (!MAPTST(&obsmap, dq.elements[i]))
 		  dq.elements[j++] = dq.elements[i];
-	      dq.count = j;
-	      map_free(&obsmap);
+	      queue_truncate(&dq, j);
+	      scratch_release(&solv->scratch, scratchmark);
 	    }
 
           /* filter out all already supplemented packages if requested */
@@ -1841,7 +2532,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		  if (!solver_is_supplementing(solv, s))
 		    dqs.elements[j++] = p;
 		}
-	      dqs.count = j;
+	      queue_truncate(&dqs, j);
 	      /* undo turning off */
 	      for (i = 0; i < solv->decisionq.count; i++)
 		{
@@ -1874,7 +2565,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		    }
 		  dqs.elements[j++] = p;
 		}
-	      dqs.count = j;
+	      queue_truncate(&dqs, j);
 	    }
 
           /* make dq contain both recommended and supplemented pkgs */
@@ -1888,6 +2579,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	    {
 	      Map dqmap;
 	      int decisioncount = solv->decisionq.count;
+	      size_t scratchmark;
 
 	      if (dq.count == 1)
 		{
@@ -1899,6 +2591,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		    POOL_DEBUG(SAT_DEBUG_POLICY, "installing recommended %s\n", solvid2str(pool, p));
 		  queue_push(&solv->recommendations, p);
 		  level = setpropagatelearn(solv, level, p, 0, 0);
+		  solv->stats.time_recommends += sat_timeus(weakstart);
 		  continue;	/* back to main loop */
 		}
 
@@ -1906,7 +2599,8 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	      policy_filter_unwanted(solv, &dq, POLICY_MODE_RECOMMEND);
 
 	      /* create map of result */
-	      map_init(&dqmap, pool->nsolvables);
+	      scratchmark = scratch_mark(&solv->scratch);
+	      scratch_map_init(&solv->scratch, &dqmap, pool->nsolvables);
 	      for (i = 0; i < dq.count; i++)
 		MAPSET(&dqmap, dq.elements[i]);
 
@@ -1925,7 +2619,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		}
 	      if (i < dqs.count || solv->decisionq.count < decisioncount)
 		{
-		  map_free(&dqmap);
+		  scratch_release(&solv->scratch, scratchmark);
 		  continue;
 		}
 
@@ -1951,7 +2645,7 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 			{
 			  if (solv->decisionmap[p] > 0)
 			    {
-			      dq.count = 0;
+			      queue_empty(&dq);
 			      break;
 			    }
 			  else if (solv->decisionmap[p] == 0 && MAPTST(&dqmap, p))
@@ -1977,10 +2671,12 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 		  if (rec)
 		    break;	/* had a problem above, quit loop */
 		}
-	      map_free(&dqmap);
+	      scratch_release(&solv->scratch, scratchmark);
 
+	      solv->stats.time_recommends += sat_timeus(weakstart);
 	      continue;		/* back to main loop so that all deps are checked */
 	    }
+	  solv->stats.time_recommends += sat_timeus(weakstart);
 	}
 
      if (solv->dupmap_all && solv->installed)
@@ -2085,7 +2781,8 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 	      p = solv->branches.elements[lasti];
 	      solv->branches.elements[lasti] = 0;
 	      POOL_DEBUG(SAT_DEBUG_SOLVER, "minimizing %d -> %d with %s\n", solv->decisionmap[p], lastl, solvid2str(pool, p));
-	      minimizationsteps++;
+	      if (!minimizationsteps++)
+		minimizestart = sat_timeus(0);	/* the rest of the run is minimization */
 
 	      level = lastl;
 	      revert(solv, level);
@@ -2105,8 +2802,10 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
       /* no minimization found, we're finally finished! */
       break;
     }
+  if (minimizationsteps)
+    solv->stats.time_minimize += sat_timeus(minimizestart);
 
-  POOL_DEBUG(SAT_DEBUG_STATS, "solver statistics: %d learned rules, %d unsolvable, %d minimization steps\n", solv->stats_learned, solv->stats_unsolvable, minimizationsteps);
+  POOL_DEBUG(SAT_DEBUG_STATS, "solver statistics: %d learned rules (%d deleted), %d unsolvable, %d minimization steps\n", solv->stats_learned, solv->stats_learned_deleted, solv->stats_unsolvable, minimizationsteps);
 
   POOL_DEBUG(SAT_DEBUG_STATS, "done solving.\n\n");
   queue_free(&dq);
@@ -2116,6 +2815,15 @@ solver_run_sat(Solver *solv, int disablerules, int doweak)
 #endif
 }
 
+void
+solver_run_sat(Solver *solv, int disablerules, int doweak)
+{
+  /* run_sat has many exits, so release its temporaries here */
+  size_t scratchmark = scratch_mark(&solv->scratch);
+  run_sat(solv, disablerules, doweak);
+  scratch_release(&solv->scratch, scratchmark);
+}
+
 
 /*-------------------------------------------------------------------
  * 
@@ -2174,7 +2882,7 @@ removedisabledconflicts(Solver *solv, Queue *removed)
 	  i = 1;
 	  r = solv->rules + i;
 	}
-      if (r->d < 0)
+      if (r->d < 0 || !r->w1)	/* disabled or deleted */
 	continue;
       if (!r->w2)
 	{
@@ -2195,7 +2903,7 @@ removedisabledconflicts(Solver *solv, Queue *removed)
 	    new = r->p;
 	  if (new || DECISIONMAP_FALSE(r->p))
 	    {
-	      dp = pool->whatprovidesdata + r->d;
+	      dp = solver_whatprovidesdata(solv, r->d);
 	      while ((p = *dp++) != 0)
 		{
 		  if (new && p == new)
@@ -2271,8 +2979,9 @@ findrecommendedsuggested(Solver *solv)
   Solvable *s;
   Rule *r;
   Map obsmap;
+  size_t scratchmark = scratch_mark(&solv->scratch);
 
-  map_init(&obsmap, pool->nsolvables);
+  scratch_map_init(&solv->scratch, &obsmap, pool->nsolvables);
   if (solv->installed)
     {
       Id obs, *obsp, p, po, ppo;
@@ -2293,8 +3002,8 @@ findrecommendedsuggested(Solver *solv)
 	}
     }
 
-  queue_init(&redoq);
-  queue_init(&disabledq);
+  scratch_queue_init(&solv->scratch, &redoq, 64);
+  scratch_queue_init(&solv->scratch, &disabledq, 64);
   goterase = 0;
   /* disable all erase jobs (including weak "keep uninstalled" rules) */
   for (i = solv->jobrules, r = solv->rules + i; i < solv->jobrules_end; i++, r++)
@@ -2455,7 +3164,7 @@ findrecommendedsuggested(Solver *solv)
   for (i = 0; i < disabledq.count; i++)
     solver_enablerule(solv, solv->rules + disabledq.elements[i]);
   queue_free(&disabledq);
-  map_free(&obsmap);
+  scratch_release(&solv->scratch, scratchmark);
 }
 
 void
@@ -2490,6 +3199,391 @@ solver_addjobrule(Solver *solv, Id p, Id d, Id job, int weak)
     queue_push(&solv->weakruleq, solv->nrules - 1);
 }
 
+/* remember the peak memory use of rules and watches in the statistics */
+static void
+updatepeakmem(Solver *solv)
+{
+  unsigned int mem;
+
+  mem = solv->nrules * sizeof(Rule);
+  if (mem > solv->stats.rules_peakmem)
+    solv->stats.rules_peakmem = mem;
+  mem = solv->nwatchdata * sizeof(Id);
+  if (solv->watches)
+    mem += 4 * solv->pool->nsolvables * sizeof(Watchlist);
+  if (mem > solv->stats.watches_peakmem)
+    solv->stats.watches_peakmem = mem;
+}
+
+/*-------------------------------------------------------------------
+ * 
+ * rpm rule reuse
+ *
+ * with reuserpmrules set, the job independent part of the rpm rules
+ * is kept when the next job is solved: the rules for the installed
+ * packages, their updaters and the packages pulled in by weak
+ * dependencies of those. It is saved right after creation and
+ * unification, so it does not contain anything a job did to the
+ * rules. Each job starts with a copy of it and adds its own rpm rules
+ * on top. As adding rpm rules is a closure over the solvables and
+ * solver_unifyrules() sorts the rules, the result is the same rule
+ * set in the same order as a fresh solver creates.
+ *
+ * The kept rules depend on the whatprovides data, on the pool
+ * architectures and considered map and on a few settings, which are
+ * recorded in rpmrules_flags.
+ */
+
+#define RPMRULES_JOBDEPENDENT		(1 << 0)	/* fixmap, noobsoletes or an update callback was used */
+#define RPMRULES_NOUPDATEPROVIDE	(1 << 1)
+#define RPMRULES_PROMOTEEPOCH		(1 << 2)
+#define RPMRULES_NOVIRTUALCONFLICTS	(1 << 3)
+#define RPMRULES_ALLOWSELFCONFLICTS	(1 << 4)
+#define RPMRULES_OBSUSESPROVIDES	(1 << 5)
+#define RPMRULES_IMPLOBSUSESPROVIDES	(1 << 6)
+#define RPMRULES_OBSUSESCOLORS		(1 << 7)
+#define RPMRULES_NOINSTALLEDOBSOLETES	(1 << 8)
+#define RPMRULES_DOSPLITPROVIDES	(1 << 9)
+
+static int
+solver_rpmrulesflags(Solver *solv, Queue *job)
+{
+  Pool *pool = solv->pool;
+  int i, flags = 0;
+
+  if (solv->fixsystem || solv->updateCandidateCb)
+    flags |= RPMRULES_JOBDEPENDENT;
+  for (i = 0; i < job->count; i += 2)
+    {
+      Id how = job->elements[i] & SOLVER_JOBMASK;
+      if (how == SOLVER_VERIFY || how == SOLVER_NOOBSOLETES)
+	flags |= RPMRULES_JOBDEPENDENT;
+    }
+  if (solv->noupdateprovide)
+    flags |= RPMRULES_NOUPDATEPROVIDE;
+  if (pool->promoteepoch)
+    flags |= RPMRULES_PROMOTEEPOCH;
+  if (pool->novirtualconflicts)
+    flags |= RPMRULES_NOVIRTUALCONFLICTS;
+  if (pool->allowselfconflicts)
+    flags |= RPMRULES_ALLOWSELFCONFLICTS;
+  if (pool->obsoleteusesprovides)
+    flags |= RPMRULES_OBSUSESPROVIDES;
+  if (pool->implicitobsoleteusesprovides)
+    flags |= RPMRULES_IMPLOBSUSESPROVIDES;
+  if (pool->obsoleteusescolors)
+    flags |= RPMRULES_OBSUSESCOLORS;
+  if (pool->noinstalledobsoletes)
+    flags |= RPMRULES_NOINSTALLEDOBSOLETES;
+  if (solv->dosplitprovides)
+    flags |= RPMRULES_DOSPLITPROVIDES;
+  return flags;
+}
+
+/*
+ * hash of the pool data pool_installable() looks at. Changing the
+ * architecture or the considered map does not invalidate the
+ * whatprovides data, so we need to check it ourself.
+ */
+static unsigned int
+solver_rpmrulespoolhash(Pool *pool)
+{
+  unsigned int r = 0;
+  unsigned char *mp;
+  int i;
+
+  if (pool->id2arch)
+    for (i = 0; i <= pool->lastarch; i++)
+      r += (r << 3) + pool->id2arch[i];
+  if (pool->considered)
+    for (i = 0, mp = pool->considered->map; i < pool->considered->size; i++)
+      r += (r << 3) + mp[i];
+  return r;
+}
+
+/*
+ * did the pool get new solvables or a different installed repo since
+ * the per solvable data was allocated?
+ */
+static int
+solver_poolsizechanged(Solver *solv)
+{
+  Pool *pool = solv->pool;
+  Repo *installed = pool->installed;
+
+  if (solv->nsolvables != pool->nsolvables || solv->installed != installed)
+    return 1;
+  /* noupdate has a bit for every installed solvable */
+  return solv->noupdate.size != ((installed ? installed->end - installed->start : 0) + 7) / 8;
+}
+
+/*
+ * can the kept rpm rules be used for this job?
+ */
+static int
+solver_canreuserpmrules(Solver *solv, Queue *job)
+{
+  int flags;
+
+  if (!solv->reuserpmrules || !solv->rpmrules_base)
+    return 0;
+  if (solver_poolsizechanged(solv))
+    return 0;
+  if (solv->rpmrules_whatprovidesgen != solv->pool->whatprovidesgen)
+    return 0;
+  if (solv->rpmrules_poolhash != solver_rpmrulespoolhash(solv->pool))
+    return 0;
+  flags = solver_rpmrulesflags(solv, job);
+  if ((flags & RPMRULES_JOBDEPENDENT) != 0 || flags != solv->rpmrules_flags)
+    return 0;
+  return 1;
+}
+
+/*
+ * remember the rpm rules created so far as the job independent part
+ */
+static void
+solver_saverpmrules(Solver *solv, Map *addedmap, int flags)
+{
+  solv->nrpmrules_base = solv->nrules;
+  solv->rpmrules_base = sat_extend_resize(solv->rpmrules_base, solv->nrules, sizeof(Rule), RULES_BLOCK);
+  memcpy(solv->rpmrules_base, solv->rules, solv->nrules * sizeof(Rule));
+  map_free(&solv->rpmrulesmap);
+  map_init_clone(&solv->rpmrulesmap, addedmap);
+  solv->rpmrules_auxmark = solv->nwhatprovidesauxdata;
+  solv->rpmrules_whatprovidesgen = solv->pool->whatprovidesgen;
+  solv->rpmrules_poolhash = solver_rpmrulespoolhash(solv->pool);
+  solv->rpmrules_flags = flags;
+}
+
+/*
+ * clear everything the last solver_solve() call left behind.
+ * if reuse is set, the saved rpm rules and the obsoletes index are
+ * kept, otherwise the solver is back in its initial state.
+ */
+static void
+solver_forgetjob(Solver *solv, int reuse)
+{
+  Pool *pool = solv->pool;
+
+  solv->nrules = 1;
+  solv->nwatchdata = 0;	/* the watch buffers are reused by makewatches */
+  /* drop the provider lists of the rules we forget */
+  solv->nwhatprovidesauxdata = reuse ? solv->rpmrules_auxmark : 0;
+  if (!reuse)
+    {
+      solv->rpmrules_base = sat_free(solv->rpmrules_base);
+      solv->nrpmrules_base = 0;
+      solv->rpmrules_auxmark = 0;
+      map_free(&solv->rpmrulesmap);
+      solv->obsoletes = sat_free(solv->obsoletes);
+      solv->obsoletes_data = sat_free(solv->obsoletes_data);
+    }
+  solv->rpmrules_end = 0;
+  solv->featurerules = solv->featurerules_end = 0;
+  solv->updaterules = solv->updaterules_end = 0;
+  solv->jobrules = solv->jobrules_end = 0;
+  solv->infarchrules = solv->infarchrules_end = 0;
+  solv->duprules = solv->duprules_end = 0;
+  solv->choicerules = solv->choicerules_end = 0;
+  solv->choicerules_ref = sat_free(solv->choicerules_ref);
+  solv->learntrules = 0;
+
+  transaction_free(&solv->trans);
+  transaction_init(&solv->trans, pool);
+  queue_empty(&solv->ruletojob);
+  queue_empty(&solv->ruleassertions);
+  queue_empty(&solv->weakruleq);
+  map_free(&solv->weakrulemap);
+
+  queue_empty(&solv->decisionq);
+  queue_empty(&solv->decisionq_why);
+  memset(solv->decisionmap, 0, solv->nsolvables * sizeof(Id));
+  solv->propagate_index = 0;
+
+  queue_empty(&solv->learnt_why);
+  queue_empty(&solv->learnt_pool);
+  queue_push(&solv->learnt_pool, 0);	/* so that 0 does not describe a proof */
+  queue_empty(&solv->learnt_lbd);
+  solv->learnt_reduce_limit = LEARNT_REDUCE_START;
+  queue_empty(&solv->branches);
+
+  queue_empty(&solv->problems);
+  queue_empty(&solv->solutions);
+  queue_empty(&solv->recommendations);
+  queue_empty(&solv->suggestions);
+  queue_empty(&solv->orphaned);
+  solv->stats_learned = 0;
+  solv->stats_learned_deleted = 0;
+  solv->stats_unsolvable = 0;
+
+  solv->recommends_index = -1;	/* rebuilt with the reference counts */
+  MAPZERO(&solv->noupdate);
+
+  map_free(&solv->noobsoletes);
+  map_free(&solv->updatemap);
+  solv->updatemap_all = 0;
+  map_free(&solv->fixmap);
+  solv->fixmap_all = 0;
+  map_free(&solv->dupmap);
+  solv->dupmap_all = 0;
+  map_free(&solv->dupinvolvedmap);
+  map_free(&solv->droporphanedmap);
+  solv->droporphanedmap_all = 0;
+  map_free(&solv->cleandepsmap);
+  solv->multiversionupdaters = sat_free(solv->multiversionupdaters);
+
+  solv->assumptions_ready = 0;
+  solv->assumptions_unsolvable = 0;
+  solv->assumptions_ruleidx = sat_free(solv->assumptions_ruleidx);
+  solv->assumptions_ruledata = sat_free(solv->assumptions_ruledata);
+}
+
+/*
+ * the pool got new solvables or a new installed repo since the per
+ * solvable data was allocated. Bring it to the new size, all of it is
+ * empty between jobs anyway. The watches are resized by makewatches().
+ */
+static void
+solver_adaptpoolsize(Solver *solv)
+{
+  Pool *pool = solv->pool;
+
+  if (!solver_poolsizechanged(solv))
+    return;
+  POOL_DEBUG(SAT_DEBUG_STATS, "pool changed: %d -> %d solvables\n", solv->nsolvables, pool->nsolvables);
+  solv->decisionmap = sat_realloc2(solv->decisionmap, pool->nsolvables, sizeof(Id));
+  memset(solv->decisionmap, 0, pool->nsolvables * sizeof(Id));
+  solv->nsolvables = pool->nsolvables;
+  map_free(&solv->recommendsmap);
+  map_init(&solv->recommendsmap, pool->nsolvables);
+  map_free(&solv->suggestsmap);
+  map_init(&solv->suggestsmap, pool->nsolvables);
+  solv->recommendsrefs = sat_free(solv->recommendsrefs);
+  solv->suggestsrefs = sat_free(solv->suggestsrefs);
+  solv->recommends_index = -1;
+  map_free(&solv->analyze_seen);
+  solv->analyze_whys = sat_free(solv->analyze_whys);
+  solv->installed = pool->installed;
+  map_free(&solv->noupdate);
+  map_init(&solv->noupdate, solv->installed ? solv->installed->end - solv->installed->start : 0);
+}
+
+/*
+ * solver_reset_for_job  - get the solver ready for the next job
+ *
+ * drops everything the last solver_solve() call left behind: the job,
+ * the rules (also the rpm rules kept for reuserpmrules), the solver's
+ * whatprovides data, decisions, problems and the transaction.
+ * The solver settings and the allocated rule, watch and queue buffers
+ * are kept, so that a solver can be used for many jobs in a row
+ * without going through solver_free()/solver_create() for each of them.
+ * Solvables may be added to the pool between the jobs, the per solvable
+ * data is resized to the new pool.
+ */
+void
+solver_reset_for_job(Solver *solv)
+{
+  solver_forgetjob(solv, 0);
+  solver_adaptpoolsize(solv);
+  queue_empty(&solv->job);
+}
+
+/*-------------------------------------------------------------------
+ *
+ * failed literal probing
+ *
+ * with only the rpm rules enabled, try to install every undecided
+ * package at level 2. If that leads to a conflict, analyze() learns
+ * a rule that is an assertion at level 1, usually "the package is not
+ * installable". The learnt rules only depend on rpm rules, so they
+ * stay enabled for the whole solver run. Their proofs are kept like
+ * for all other learnt rules, so problems found later still point to
+ * the rpm rules that caused them.
+ * Called after the assertion index is created, the solver is back at
+ * level 0 when we return.
+ */
+
+static void
+probepackages(Solver *solv)
+{
+  Pool *pool = solv->pool;
+  Id *decisionmap = solv->decisionmap;
+  Queue disabled;
+  Map okmap;
+  Rule *r;
+  Id p, v, rid;
+  int i, level, nfailed = 0;
+  int oldproblemcount = solv->problems.count;
+  unsigned int branches = solv->stats.branches;
+  int now = sat_timems(0);
+  size_t scratchmark = scratch_mark(&solv->scratch);
+
+  /* switch off everything but the rpm rules */
+  scratch_queue_init(&solv->scratch, &disabled, solv->learntrules - solv->rpmrules_end);
+  for (rid = solv->rpmrules_end, r = solv->rules + rid; rid < solv->learntrules; rid++, r++)
+    if (r->d >= 0)
+      {
+	solver_disablerule(solv, r);
+	queue_push(&disabled, rid);
+      }
+
+  /* decide the rpm rule assertions */
+  for (i = 0; i < solv->ruleassertions.count; i++)
+    {
+      rid = solv->ruleassertions.elements[i];
+      r = solv->rules + rid;
+      if (r->d < 0)
+	continue;
+      v = r->p;
+      if (DECISIONMAP_TRUE(v))
+	continue;
+      if (DECISIONMAP_FALSE(v))
+	break;			/* conflict, leave it to the solver */
+      decisionmap[v > 0 ? v : -v] = v > 0 ? 1 : -1;
+      queue_push(&solv->decisionq, v);
+      queue_push(&solv->decisionq_why, rid);
+    }
+
+  /* packages installed by a successful probe cannot fail themselves,
+   * as their propagation is part of the one we just did */
+  scratch_map_init(&solv->scratch, &okmap, pool->nsolvables);
+  if (i == solv->ruleassertions.count && !propagate(solv, 1))
+    {
+      for (p = 2; p < pool->nsolvables; p++)
+	{
+	  if (decisionmap[p] || !pool->solvables[p].repo || MAPTST(&okmap, p))
+	    continue;
+	  if (solver_budgetexhausted(solv))
+	    break;
+	  i = solv->decisionq.count;
+	  level = setpropagatelearn(solv, 1, p, 0, 0);
+	  if (level > 1)
+	    {
+	      for (; i < solv->decisionq.count; i++)
+		if ((v = solv->decisionq.elements[i]) > 0)
+		  MAPSET(&okmap, v);
+	      revert(solv, 1);
+	      continue;
+	    }
+	  if (!level)
+	    break;		/* the rpm rules conflict, leave it to the solver */
+	  nfailed++;
+	}
+    }
+
+  /* back to level 0 with all rules */
+  revert(solv, 0);
+  solv->problems.count = oldproblemcount;
+  for (i = 0; i < disabled.count; i++)
+    solver_enablerule(solv, solv->rules + disabled.elements[i]);
+  queue_free(&disabled);
+  scratch_release(&solv->scratch, scratchmark);
+  solv->stats.branches = branches;
+  POOL_DEBUG(SAT_DEBUG_STATS, "probing found %d uninstallable packages\n", nfailed);
+  POOL_DEBUG(SAT_DEBUG_STATS, "probing took %d ms\n", sat_timems(now));
+}
+
 /*
  *
  * solve job queue
@@ -2500,7 +3594,7 @@ void
 solver_solve(Solver *solv, Queue *job)
 {
   Pool *pool = solv->pool;
-  Repo *installed = solv->installed;
+  Repo *installed;
   int i;
   int oldnrules;
   Map addedmap;		       /* '1' == have rpm-rules for solvable */
@@ -2510,9 +3604,15 @@ solver_solve(Solver *solv, Queue *job)
   Solvable *s;
   Rule *r;
   int now, solve_start;
+  unsigned int solve_startus, phase;
   int hasdupjob = 0;
+  int reuse, rpmrulesflags;
+  size_t scratchmark;
 
   solve_start = sat_timems(0);
+  solve_startus = sat_timeus(0);
+  memset(&solv->stats, 0, sizeof(solv->stats));
+  solver_startbudget(solv);
 
   /* log solver options */
   POOL_DEBUG(SAT_DEBUG_STATS, "solver started\n");
@@ -2524,11 +3624,20 @@ solver_solve(Solver *solv, Queue *job)
   POOL_DEBUG(SAT_DEBUG_STATS, "dontinstallrecommended=%d, ignorealreadyrecommended=%d, dontshowinstalledrecommended=%d\n", solv->dontinstallrecommended, solv->ignorealreadyrecommended, solv->dontshowinstalledrecommended);
 
   /* create whatprovides if not already there */
-  if (!pool->whatprovides)
+  if (!pool->whatprovides || pool->whatprovidesstale)
     pool_createwhatprovides(pool);
 
+  /* clean up after the last job */
+  reuse = solver_canreuserpmrules(solv, job);
+  if (solv->rpmrules_end || solv->rpmrules_base)
+    solver_forgetjob(solv, reuse);
+  solver_adaptpoolsize(solv);
+  installed = solv->installed;
+  rpmrulesflags = solver_rpmrulesflags(solv, job);
+
   /* create obsolete index */
-  policy_create_obsolete_index(solv);
+  if (!reuse)
+    policy_create_obsolete_index(solv);
 
   /* remember job */
   queue_free(&solv->job);
@@ -2548,11 +3657,24 @@ solver_solve(Solver *solv, Queue *job)
   /* create noobsolete map if needed */
   solver_calculate_noobsmap(pool, job, &solv->noobsoletes);
 
-  map_init(&addedmap, pool->nsolvables);
-  MAPSET(&addedmap, SYSTEMSOLVABLE);
+  if (reuse)
+    {
+      /* start with the kept rpm rules */
+      solv->nrules = solv->nrpmrules_base;
+      solv->rules = sat_extend_resize(solv->rules, solv->nrules, sizeof(Rule), RULES_BLOCK);
+      memcpy(solv->rules, solv->rpmrules_base, solv->nrules * sizeof(Rule));
+      map_init_clone(&addedmap, &solv->rpmrulesmap);
+      POOL_DEBUG(SAT_DEBUG_STATS, "reusing %d rpm rules\n", solv->nrules - 1);
+    }
+  else
+    {
+      map_init(&addedmap, pool->nsolvables);
+      MAPSET(&addedmap, SYSTEMSOLVABLE);
+    }
 
-  map_init(&installcandidatemap, pool->nsolvables);
-  queue_init(&q);
+  scratchmark = scratch_mark(&solv->scratch);
+  scratch_map_init(&solv->scratch, &installcandidatemap, pool->nsolvables);
+  scratch_queue_init(&solv->scratch, &q, 64);
 
   now = sat_timems(0);
   /*
@@ -2600,7 +3722,9 @@ solver_solve(Solver *solv, Queue *job)
 	      break;
 	    }
 	}
-
+    }
+  if (installed && !reuse)
+    {
       oldnrules = solv->nrules;
       POOL_DEBUG(SAT_DEBUG_SCHUBI, "*** create rpm rules for installed solvables ***\n");
       FOR_REPO_SOLVABLES(installed, p, s)
@@ -2612,6 +3736,14 @@ solver_solve(Solver *solv, Queue *job)
 	solver_addrpmrulesforupdaters(solv, s, &addedmap, 1);
       POOL_DEBUG(SAT_DEBUG_STATS, "added %d rpm rules for updaters of installed solvables\n", solv->nrules - oldnrules);
     }
+  if (solv->reuserpmrules && !reuse && !(rpmrulesflags & RPMRULES_JOBDEPENDENT))
+    {
+      /* complete and keep the job independent part. Adding the weak
+       * rules now does not change the final rule set, see above */
+      solver_addrpmrulesforweak(solv, &addedmap);
+      solver_unifyrules(solv);
+      solver_saverpmrules(solv, &addedmap, rpmrulesflags);
+    }
 
   /*
    * create rules for all packages involved in the job
@@ -2680,7 +3812,12 @@ solver_solve(Solver *solv, Queue *job)
       POOL_DEBUG(SAT_DEBUG_STATS, "%d of %d installable solvables considered for solving\n", possible, installable);
     }
 
-  solver_unifyrules(solv);                          /* remove duplicate rpm rules */
+  if (!reuse || solv->nrules != solv->nrpmrules_base)
+    {
+      phase = sat_timeus(0);
+      solver_unifyrules(solv);                      /* remove duplicate rpm rules */
+      solv->stats.time_unify = sat_timeus(phase);
+    }
   solv->rpmrules_end = solv->nrules;              /* mark end of rpm rules */
 
   POOL_DEBUG(SAT_DEBUG_STATS, "rpm rule memory usage: %d K\n", solv->nrules * (int)sizeof(Rule) / 1024);
@@ -2824,7 +3961,7 @@ solver_solve(Solver *solv, Queue *job)
 		  queue_push(&q, -SYSTEMSOLVABLE);
 		}
 	      p = queue_shift(&q);	/* get first candidate */
-	      d = !q.count ? 0 : pool_queuetowhatprovides(pool, &q);	/* internalize */
+	      d = !q.count ? 0 : solver_queuetowhatprovides(solv, &q);	/* internalize */
 	    }
 	  solver_addjobrule(solv, p, d, i, weak);
 	  break;
@@ -2962,8 +4099,8 @@ solver_solve(Solver *solv, Queue *job)
     
   /* free unneeded memory */
   map_free(&addedmap);
-  map_free(&installcandidatemap);
   queue_free(&q);
+  scratch_release(&solv->scratch, scratchmark);
 
   POOL_DEBUG(SAT_DEBUG_STATS, "%d rpm rules, %d job rules, %d infarch rules, %d dup rules, %d choice rules\n", solv->rpmrules_end - 1, solv->jobrules_end - solv->jobrules, solv->infarchrules_end - solv->infarchrules, solv->duprules_end - solv->duprules, solv->choicerules_end - solv->choicerules);
 
@@ -2977,9 +4114,12 @@ solver_solve(Solver *solv, Queue *job)
 
   /* all new rules are learnt after this point */
   solv->learntrules = solv->nrules;
+  solv->learntrules_auxmark = solv->nwhatprovidesauxdata;
 
   /* create watches chains */
   makewatches(solv);
+  solv->stats.time_rules = sat_timeus(solve_startus) - solv->stats.time_unify;
+  updatepeakmem(solv);
 
   /* create assertion index. it is only used to speed up
    * makeruledecsions() a bit */
@@ -2987,6 +4127,9 @@ solver_solve(Solver *solv, Queue *job)
     if (r->p && !r->w2 && (r->d == 0 || r->d == -1))
       queue_push(&solv->ruleassertions, i);
 
+  if (solv->probeliterals)
+    probepackages(solv);
+
   /* disable update rules that conflict with our job */
   solver_disablepolicyrules(solv);
 
@@ -3001,28 +4144,433 @@ solver_solve(Solver *solv, Queue *job)
    */
     
   now = sat_timems(0);
+  phase = sat_timeus(0);
   solver_run_sat(solv, 1, solv->dontinstallrecommended ? 0 : 1);
+  solv->stats.time_sat = sat_timeus(phase);
+  updatepeakmem(solv);
   POOL_DEBUG(SAT_DEBUG_STATS, "solver took %d ms\n", sat_timems(now));
 
+  if (solv->budget_exhausted)
+    {
+      /* the decisions are incomplete, so there is no result */
+      queue_empty(&solv->problems);
+      queue_empty(&solv->recommendations);
+      transaction_free(&solv->trans);
+      transaction_init(&solv->trans, pool);
+      solv->stats.learned = solv->stats_learned;
+      solv->stats.time_total = sat_timeus(solve_startus);
+      POOL_DEBUG(SAT_DEBUG_STATS, "solver_solve gave up after %d ms\n", sat_timems(solve_start));
+      return;
+    }
+
   /*
    * calculate recommended/suggested packages
    */
+  phase = sat_timeus(0);
   findrecommendedsuggested(solv);
+  solv->stats.time_recommends += sat_timeus(phase);
 
   /*
    * prepare solution queue if there were problems
    */
+  phase = sat_timeus(0);
   solver_prepare_solutions(solv);
+  solv->stats.time_problems = sat_timeus(phase);
+  updatepeakmem(solv);
 
   /*
    * finally prepare transaction info
    */
+  phase = sat_timeus(0);
   transaction_calculate(&solv->trans, &solv->decisionq, &solv->noobsoletes);
+  solv->stats.time_transaction = sat_timeus(phase);
+  solv->stats.learned = solv->stats_learned;
+  solv->stats.time_total = sat_timeus(solve_startus);
 
-  POOL_DEBUG(SAT_DEBUG_STATS, "final solver statistics: %d problems, %d learned rules, %d unsolvable\n", solv->problems.count / 2, solv->stats_learned, solv->stats_unsolvable);
+  POOL_DEBUG(SAT_DEBUG_STATS, "final solver statistics: %d problems, %d learned rules (%d deleted), %d unsolvable\n", solv->problems.count / 2, solv->stats_learned, solv->stats_learned_deleted, solv->stats_unsolvable);
   POOL_DEBUG(SAT_DEBUG_STATS, "solver_solve took %d ms\n", sat_timems(solve_start));
 }
 
+/***********************************************************************/
+/* assumption based solving */
+
+/*-------------------------------------------------------------------
+ *
+ * collect the rules of a proof in the learnt_pool, learnt rules
+ * are replaced by their own proofs
+ */
+
+static void
+assumptions_proofrules(Solver *solv, Id idx, Queue *rules)
+{
+  Id rid;
+  while ((rid = solv->learnt_pool.elements[idx++]) != 0)
+    {
+      if (rid >= solv->learntrules)
+	{
+	  assumptions_proofrules(solv, solv->learnt_why.elements[rid - solv->learntrules], rules);
+	  continue;
+	}
+      queue_pushunique(rules, rid);
+    }
+}
+
+static inline void
+assumptions_addrule(Solver *solv, Id rid, Queue *rules)
+{
+  if (rid >= solv->learntrules)
+    assumptions_proofrules(solv, solv->learnt_why.elements[rid - solv->learntrules], rules);
+  else
+    queue_pushunique(rules, rid);
+}
+
+/*-------------------------------------------------------------------
+ *
+ * an assumption is false, find the rules that lead to this by
+ * following the implication graph back to the assumptions
+ */
+
+static void
+analyze_assumptions(Solver *solv, Id v, Queue *rules)
+{
+  Pool *pool = solv->pool;
+  Map seen;
+  Rule *r;
+  Id why, vv, d, *dp;
+  int i, idx;
+  size_t scratchmark = scratch_mark(&solv->scratch);
+
+  scratch_map_init(&solv->scratch, &seen, pool->nsolvables);
+  MAPSET(&seen, v > 0 ? v : -v);
+  for (idx = solv->decisionq.count; idx > 0; )
+    {
+      v = solv->decisionq.elements[--idx];
+      vv = v > 0 ? v : -v;
+      if (!MAPTST(&seen, vv))
+	continue;
+      why = solv->decisionq_why.elements[idx];
+      if (why <= 0)
+	continue;		/* an assumption */
+      assumptions_addrule(solv, why, rules);
+      r = solv->rules + why;
+      d = r->d < 0 ? -r->d - 1 : r->d;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
+      for (i = -1; ; i++)
+	{
+	  if (i == -1)
+	    v = r->p;
+	  else if (d == 0)
+	    v = i ? 0 : r->w2;
+	  else
+	    v = *dp++;
+	  if (v == 0)
+	    break;
+	  MAPSET(&seen, v > 0 ? v : -v);
+	}
+    }
+  scratch_release(&solv->scratch, scratchmark);
+}
+
+/*-------------------------------------------------------------------
+ *
+ * switch the solver to assumption mode
+ *
+ * the rules enabled by the last solver_solve() call stay, except for
+ * the weak ones. Learnt rules are dropped as they may depend on weak
+ * rules. Then the assertions are decided at level 1 and an index
+ * from solvables to the rules that contain them as negative literal
+ * is built. Slot 0 of the index lists the rules without any negative
+ * literal.
+ */
+
+static void
+solver_prepare_assumptions(Solver *solv)
+{
+  Pool *pool = solv->pool;
+  Id *decisionmap = solv->decisionmap;
+  Id *ruleidx, *ruledata;
+  Rule *r;
+  Id rid, v, vv, d, *dp;
+  int i, j, n, oldproblemcount;
+
+  solv->assumptions_ready = 1;
+  solv->assumptions_unsolvable = 0;
+
+  /* forget the decisions and learnt rules of the last solve */
+  revert(solv, 0);
+  truncatewatches(solv, solv->learntrules);
+  solv->nrules = solv->learntrules;
+  solv->nwhatprovidesauxdata = solv->learntrules_auxmark;
+  queue_empty(&solv->learnt_why);
+  queue_empty(&solv->learnt_lbd);
+  solv->stats_learned_deleted = 0;
+  solv->learnt_reduce_limit = LEARNT_REDUCE_START;
+  for (i = j = 0; i < solv->ruleassertions.count; i++)
+    if (solv->ruleassertions.elements[i] < solv->learntrules)
+      solv->ruleassertions.elements[j++] = solv->ruleassertions.elements[i];
+  solv->ruleassertions.count = j;
+
+  /* assumptions are hard, so weak rules must not be used */
+  for (rid = 1, r = solv->rules + rid; rid < solv->nrules; rid++, r++)
+    if (solv->weakrulemap.size && MAPTST(&solv->weakrulemap, rid))
+      solver_disablerule(solv, r);
+
+  /* build the rule index */
+  ruleidx = solv->assumptions_ruleidx = sat_calloc(pool->nsolvables + 1, sizeof(Id));
+  ruledata = 0;
+  for (n = 0; n < 2; n++)
+    {
+      for (rid = 1, r = solv->rules + rid; rid < solv->nrules; rid++, r++)
+	{
+	  int neg = 0;
+	  if (r->d < 0 || !r->w1)
+	    continue;
+	  d = r->d;
+	  dp = d ? solver_whatprovidesdata(solv, d) : 0;
+	  for (i = -1; ; i++)
+	    {
+	      if (i == -1)
+		v = r->p;
+	      else if (d == 0)
+		v = i ? 0 : r->w2;
+	      else
+		v = *dp++;
+	      if (v == 0)
+		break;
+	      if (v > 0)
+		continue;
+	      neg = 1;
+	      if (n)
+		ruledata[--ruleidx[-v]] = rid;
+	      else
+		ruleidx[-v]++;
+	    }
+	  if (neg)
+	    continue;
+	  if (n)
+	    ruledata[--ruleidx[0]] = rid;
+	  else
+	    ruleidx[0]++;
+	}
+      if (n)
+	break;
+      for (i = 0, j = 0; i < pool->nsolvables; i++)
+	ruleidx[i] = j += ruleidx[i];
+      ruleidx[pool->nsolvables] = j;
+      ruledata = solv->assumptions_ruledata = sat_malloc2(j + 1, sizeof(Id));
+    }
+
+  /* decide the assertions */
+  for (i = 0; i < solv->ruleassertions.count; i++)
+    {
+      rid = solv->ruleassertions.elements[i];
+      r = solv->rules + rid;
+      if (r->d < 0)
+	continue;
+      v = r->p;
+      vv = v > 0 ? v : -v;
+      if (DECISIONMAP_TRUE(v))
+	continue;
+      if (DECISIONMAP_FALSE(v))
+	{
+	  /* two assertions conflict, create a proof for them */
+	  for (j = 0; j < solv->decisionq.count; j++)
+	    if (solv->decisionq.elements[j] == -v)
+	      break;
+	  solv->assumptions_unsolvable = solv->learnt_pool.count;
+	  queue_push(&solv->learnt_pool, rid);
+	  queue_push(&solv->learnt_pool, solv->decisionq_why.elements[j]);
+	  queue_push(&solv->learnt_pool, 0);
+	  return;
+	}
+      decisionmap[vv] = v > 0 ? 1 : -1;
+      queue_push(&solv->decisionq, v);
+      queue_push(&solv->decisionq_why, rid);
+    }
+  r = propagate(solv, 1);
+  if (r)
+    {
+      oldproblemcount = solv->problems.count;
+      analyze_unsolvable(solv, r, 0);
+      solv->assumptions_unsolvable = solv->problems.elements[oldproblemcount];
+      solv->problems.count = oldproblemcount;
+    }
+}
+
+/*-------------------------------------------------------------------
+ *
+ * make sure the rules indexed under solvable v are fulfilled. Only
+ * rules whose negative literals are all true need a decision.
+ * returns 1 if there was a conflict, the new level is in *levelp
+ */
+
+static int
+assumptions_decide(Solver *solv, int *levelp, Id v, Queue *dq)
+{
+  Id *decisionmap = solv->decisionmap;
+  Id *rp, *rpend, rid, d, *dp, p;
+  Rule *r;
+  int i, olevel;
+
+  rp = solv->assumptions_ruledata + solv->assumptions_ruleidx[v];
+  rpend = solv->assumptions_ruledata + solv->assumptions_ruleidx[v + 1];
+  for (; rp < rpend; rp++)
+    {
+      rid = *rp;
+      r = solv->rules + rid;
+      if (r->d < 0)
+	continue;
+      queue_empty(dq);
+      d = r->d;
+      dp = d ? solver_whatprovidesdata(solv, d) : 0;
+      for (i = -1; ; i++)
+	{
+	  if (i == -1)
+	    p = r->p;
+	  else if (d == 0)
+	    p = i ? 0 : r->w2;
+	  else
+	    p = *dp++;
+	  if (p == 0)
+	    break;
+	  if (DECISIONMAP_TRUE(p))
+	    break;
+	  if (p < 0 && !decisionmap[-p])
+	    break;		/* fulfilled if -p does not get installed */
+	  if (p > 0 && !decisionmap[p])
+	    queue_push(dq, p);
+	}
+      if (p)
+	continue;
+      /* propagate() made sure that we have at least two candidates */
+      assert(dq->count > 1);
+      olevel = *levelp;
+      *levelp = selectandinstall(solv, olevel, dq, 0, rid);
+      if (*levelp <= olevel)
+	return 1;
+    }
+  return 0;
+}
+
+/*-------------------------------------------------------------------
+ *
+ * solver_solve_assumptions
+ *
+ * check if the rules set up by the last solver_solve() call can be
+ * fulfilled with all literals in assumptions being true. A positive
+ * literal means "install", a negative one "do not install".
+ * The rules are kept between calls, so asking many questions is
+ * much cheaper than solving one job per question. All solvables used
+ * in the assumptions need rpm rules, e.g. by adding them to the job
+ * as SOLVER_INSTALL|SOLVER_WEAK.
+ *
+ * returns 1 if solvable, the solution is in the decisionmap.
+ * returns 0 if not solvable, the rules leading to that are stored
+ * in problemrules (if not NULL).
+ */
+
+int
+solver_solve_assumptions(Solver *solv, Queue *assumptions, Queue *problemrules)
+{
+  Queue dq;
+  Id v, failed, *decisionmap;
+  int i, level, olevel, idx, oldproblemcount;
+
+  if (problemrules)
+    queue_empty(problemrules);
+  if (!solv->assumptions_ready)
+    solver_prepare_assumptions(solv);
+  if (solv->assumptions_unsolvable)
+    {
+      if (problemrules)
+	assumptions_proofrules(solv, solv->assumptions_unsolvable, problemrules);
+      return 0;
+    }
+  decisionmap = solv->decisionmap;
+  oldproblemcount = solv->problems.count;
+  revert(solv, 1);
+  level = 1;
+  failed = 0;
+  queue_init(&dq);
+  for (;;)
+    {
+      /* (re-)establish the assumptions */
+      for (i = 0; i < assumptions->count; i++)
+	{
+	  v = assumptions->elements[i];
+	  if (DECISIONMAP_TRUE(v))
+	    continue;
+	  if (DECISIONMAP_FALSE(v))
+	    {
+	      failed = v;
+	      break;
+	    }
+	  olevel = level;
+	  level = setpropagatelearn(solv, level, v, 0, 0);
+	  if (!level)
+	    break;
+	  if (level <= olevel)
+	    i = -1;		/* conflict, start over */
+	}
+      if (i < assumptions->count)
+	break;
+
+      /* now fulfill the rules without negative literals and the
+       * rules of all installed packages */
+      if (!assumptions_decide(solv, &level, 0, &dq))
+	{
+	  for (idx = 0; idx < solv->decisionq.count; idx++)
+	    {
+	      v = solv->decisionq.elements[idx];
+	      if (v > 0 && assumptions_decide(solv, &level, v, &dq))
+		break;
+	    }
+	  if (idx == solv->decisionq.count)
+	    break;		/* all rules fulfilled */
+	}
+      if (!level)
+	break;
+      /* we got a conflict, start over */
+    }
+  queue_free(&dq);
+
+  if (!level)
+    {
+      /* the rules are unsolvable even without assumptions */
+      solv->assumptions_unsolvable = solv->problems.elements[oldproblemcount];
+      solv->problems.count = oldproblemcount;
+      if (problemrules)
+	assumptions_proofrules(solv, solv->assumptions_unsolvable, problemrules);
+      return 0;
+    }
+  if (failed)
+    {
+      if (problemrules)
+	analyze_assumptions(solv, failed, problemrules);
+      return 0;
+    }
+  return 1;
+}
+
+/*-------------------------------------------------------------------
+ *
+ * convenience function: can p be installed?
+ */
+
+int
+solver_installable(Solver *solv, Id p, Queue *problemrules)
+{
+  Queue assumptions;
+  Id assumptionsbuf[1];
+  int r;
+
+  queue_init_buffer(&assumptions, assumptionsbuf, sizeof(assumptionsbuf)/sizeof(*assumptionsbuf));
+  queue_push(&assumptions, p);
+  r = solver_solve_assumptions(solv, &assumptions, problemrules);
+  queue_free(&assumptions);
+  return r;
+}
+
 /***********************************************************************/
 /* disk usage computations */
 
@@ -22,6 +22,7 @@ extern "C" {
 #include "repo.h"
 #include "queue.h"
 #include "bitmap.h"
+#include "scratch.h"
 #include "transaction.h"
 #include "rules.h"
 #include "problems.h"
@@ -38,6 +39,46 @@ typedef void (*UpdateCandidateCb) (Pool *pool, Solvable *solvable, Queue *candit
 
 struct _Solver;
 
+/*
+ * watch list of a literal. Contains pairs of (rule id, blocker),
+ * where the blocker is some other literal of the rule. If the
+ * blocker is true, the rule is fulfilled and needs not be looked at.
+ * The pairs are stored in solv->watchdata starting at 'off'.
+ */
+typedef struct _Watchlist {
+  Id off;		/* offset into watchdata */
+  int count;		/* number of Ids in the list */
+  int left;		/* space left after off+count */
+} Watchlist;
+
+/*
+ * statistics of the last solver_solve() call, times are in microseconds.
+ * The propagation, minimization and recommends times are summed up
+ * over all solver runs, including the ones of the problem refinement,
+ * so they can overlap with time_problems.
+ */
+typedef struct _SolverStats {
+  unsigned int time_total;
+  unsigned int time_rules;		/* rule and watch creation, without unify */
+  unsigned int time_unify;		/* solver_unifyrules() */
+  unsigned int time_sat;		/* main solver_run_sat() call */
+  unsigned int time_propagate;		/* unit propagation, only with SAT_DEBUG_STATS */
+  unsigned int time_minimize;		/* minimization of the solution */
+  unsigned int time_recommends;		/* recommended/supplemented packages */
+  unsigned int time_problems;		/* problem refinement */
+  unsigned int time_transaction;	/* transaction calculation */
+
+  unsigned int propagations;		/* propagated decisions */
+  unsigned int watchvisits;		/* watches looked at while propagating */
+  unsigned int conflicts;
+  unsigned int learned;			/* learnt rules */
+  unsigned int restarts;		/* restarts after a problem was found */
+  unsigned int branches;		/* free decisions */
+
+  unsigned int rules_peakmem;		/* bytes used by the rules */
+  unsigned int watches_peakmem;		/* bytes used by the watch lists */
+} SolverStats;
+
 typedef struct _Solver {
   Pool *pool;				/* back pointer to pool */
   Queue job;				/* copy of the job we're solving */
@@ -93,11 +134,18 @@ typedef struct _Solver {
   Queue weakruleq;			/* index into 'rules' for weak ones */
   Map weakrulemap;			/* map rule# to '1' for weak rules, 1..learntrules */
 
-  Id *watches;				/* Array of rule offsets
+  Watchlist *watches;			/* Array of watch lists
 					 * watches has nsolvables*2 entries and is addressed from the middle
-					 * middle-solvable : decision to conflict, offset point to linked-list of rules
-					 * middle+solvable : decision to install: offset point to linked-list of rules
+					 * middle-solvable : decision to conflict, list of rules watching -solvable
+					 * middle+solvable : decision to install: list of rules watching solvable
+					 */
+  Watchlist *binwatches;		/* Same for binary rules, the list contains
+					 * pairs of (other literal, rule offset)
+					 * shares the allocation with watches
 					 */
+  Id *watchdata;			/* storage for all watch lists */
+  int nwatchdata;			/* used size of watchdata */
+  int nwatches;				/* allocated watch lists, kept for the next job */
 
   Queue ruletojob;                      /* index into job queue: jobs for which a rule exits */
 
@@ -109,10 +157,16 @@ typedef struct _Solver {
 					 * = 0: undecided
 					 * > 0: level of decision when installed,
 					 * < 0: level of decision when conflict */
+  int nsolvables;			/* pool->nsolvables the per solvable data is allocated for */
 
   /* learnt rule history */
   Queue learnt_why;
   Queue learnt_pool;
+  Queue learnt_lbd;			/* literal block distance of each learnt rule */
+  int learnt_reduce_limit;		/* delete learnt rules when we have more than this */
+
+  Map analyze_seen;			/* tmp space for analyze(), created on first use, all clear between calls */
+  Id *analyze_whys;			/* tmp space for analyze(), decisionq_why by solvable */
 
   Queue branches;
   int (*solution_callback)(struct _Solver *solv, void *data);
@@ -128,16 +182,39 @@ typedef struct _Solver {
   Queue orphaned;			/* orphaned packages */
 
   int stats_learned;			/* statistic */
+  int stats_learned_deleted;		/* statistic */
   int stats_unsolvable;			/* statistic */
+  SolverStats stats;			/* filled by solver_solve() */
 
   Map recommendsmap;			/* recommended packages from decisionmap */
   Map suggestsmap;			/* suggested packages from decisionmap */
   int recommends_index;			/* recommendsmap/suggestsmap is created up to this level */
+  Id *recommendsrefs;			/* number of decisions recommending a package */
+  Id *suggestsrefs;			/* number of decisions suggesting a package */
 
   Id *obsoletes;			/* obsoletes for each installed solvable */
   Id *obsoletes_data;			/* data area for obsoletes */
   Id *multiversionupdaters;		/* updaters for multiversion packages in updatesystem mode */
 
+  Rule *rpmrules_base;			/* job independent rpm rules, kept for the next job if reuserpmrules is set */
+  int nrpmrules_base;
+  Map rpmrulesmap;			/* solvables with rules in rpmrules_base */
+  int rpmrules_whatprovidesgen;		/* pool->whatprovidesgen at rpm rule creation */
+  unsigned int rpmrules_poolhash;	/* hash of the pool architectures and considered map */
+  int rpmrules_flags;			/* settings the rpm rules depend on, see solver_rpmrulesflags() */
+
+  int assumptions_ready;		/* set up for solver_solve_assumptions() */
+  Id assumptions_unsolvable;		/* learnt_pool index of the proof if the rules conflict by themselves */
+  Id *assumptions_ruleidx;		/* solvable -> offset into assumptions_ruledata */
+  Id *assumptions_ruledata;		/* rules containing the solvable as negative literal */
+
+  Id *whatprovidesauxdata;		/* provider lists of the solver if the pool is frozen */
+  int nwhatprovidesauxdata;
+  int rpmrules_auxmark;			/* nwhatprovidesauxdata after the kept rpm rules */
+  int learntrules_auxmark;		/* nwhatprovidesauxdata before the first learnt rule */
+
+  Scratch scratch;			/* temporary queues and maps of the solver functions */
+
   /*-------------------------------------------------------------------------------------------------------------
    * Solver configuration
    *-------------------------------------------------------------------------------------------------------------*/
@@ -160,6 +237,45 @@ typedef struct _Solver {
 
   int noinfarchcheck;			/* true: do not forbid inferior architectures */
 
+  /* true: before solving, find the packages that the rpm rules do not
+   * allow to be installed by trying to install each one (failed literal
+   * probing). This costs one propagation per package. The result stays
+   * correct, but the reported problems can differ.
+   */
+  int probeliterals;
+
+  /* true: keep the job independent rpm rules for the next solver_solve()
+   * call. The rules are rebuilt if the whatprovides data, the pool
+   * architectures or a setting the rules depend on changed. Jobs that
+   * need special rpm rules (fixsystem, SOLVER_VERIFY, SOLVER_NOOBSOLETES,
+   * an updateCandidateCb) do not use the kept rules. The result is the
+   * same as with a fresh solver.
+   */
+  int reuserpmrules;
+
+  /* number of threads used to create the rpm rules. Only used if the
+   * pool is frozen (see pool_freeze()), the rules are the same as with
+   * a single thread.
+   */
+  int rpmrulethreads;
+
+  /* solve budget, 0 means no limit. It is checked in the main loop of
+   * the solver. If it is exhausted, solver_solve() stops and returns
+   * without problems and transaction, budget_exhausted tells why.
+   * Problem refinement (solver_solution_count()) gets a new budget
+   * and stops with the solutions found so far.
+   */
+  unsigned int maxpropagations;
+  unsigned int maxconflicts;
+  unsigned int maxsolvetime;		/* milliseconds */
+  int (*cancel_callback)(struct _Solver *solv, void *data);	/* return true to stop solving */
+  void *cancel_callback_data;
+
+  int budget_exhausted;			/* SOLVER_BUDGET_xxx, result of the last run */
+  unsigned int budget_start;		/* sat_timems() when the budget was started */
+  unsigned int budget_propagations;	/* stats.propagations when the budget was started */
+  unsigned int budget_conflicts;	/* stats.conflicts when the budget was started */
+
   /* Callbacks for defining the bahaviour of the SAT solver */
 
   /* Finding best candidate
@@ -256,6 +372,12 @@ typedef struct _Solver {
 
 #define SOLVER_SETMASK			0x2f000000
 
+/* values of solv->budget_exhausted */
+#define SOLVER_BUDGET_PROPAGATIONS	1
+#define SOLVER_BUDGET_CONFLICTS		2
+#define SOLVER_BUDGET_TIME		3
+#define SOLVER_BUDGET_CANCELLED		4
+
 /* old API compatibility, do not use in new code */
 #if 1
 #define SOLVER_INSTALL_SOLVABLE (SOLVER_INSTALL|SOLVER_SOLVABLE)
@@ -291,15 +413,24 @@ typedef struct _Solver {
 extern Solver *solver_create(Pool *pool);
 extern void solver_free(Solver *solv);
 extern void solver_solve(Solver *solv, Queue *job);
+extern void solver_reset_for_job(Solver *solv);
 
 extern void solver_run_sat(Solver *solv, int disablerules, int doweak);
 extern void solver_reset(Solver *solv);
+extern void solver_startbudget(Solver *solv);
+extern int solver_budgetexhausted(Solver *solv);
 
 extern int solver_dep_installed(Solver *solv, Id dep);
 extern int solver_splitprovides(Solver *solv, Id dep);
+extern Id solver_queuetowhatprovides(Solver *solv, Queue *q);
 
 extern void solver_calculate_noobsmap(Pool *pool, Queue *job, Map *noobsmap);
 
+extern int solver_solve_assumptions(Solver *solv, Queue *assumptions, Queue *problemrules);
+extern int solver_installable(Solver *solv, Id p, Queue *problemrules);
+
+extern void solver_solve_batch(Pool *pool, Queue *jobs, int njobs, int nthreads, void (*setup)(Solver *solv, void *data), void *setupdata, Transaction *trans, int *nproblems);
+
 /* obsolete */
 extern SolverRuleinfo solver_problemruleinfo(Solver *solv, Queue *job, Id rid, Id *depp, Id *sourcep, Id *targetp);
 
@@ -372,12 +503,24 @@ solver_create_state_maps(Solver *solv, Map *installedmap, Map *conflictsmap)
   pool_create_state_maps(solv->pool, &solv->decisionq, installedmap, conflictsmap);
 }
 
+/* the provider lists that the solver creates for a frozen pool live
+ * in the solver, their offsets have this bit set */
+#define SOLVER_WHATPROVIDES_AUX		0x40000000
+
+static inline Id *
+solver_whatprovidesdata(Solver *solv, Id d)
+{
+  if ((d & SOLVER_WHATPROVIDES_AUX) != 0)
+    return solv->whatprovidesauxdata + (d ^ SOLVER_WHATPROVIDES_AUX);
+  return solv->pool->whatprovidesdata + d;
+}
+
 /* iterate over all literals of a rule */
 /* WARNING: loop body must not relocate whatprovidesdata, e.g. by
  * looking up the providers of a dependency */
 #define FOR_RULELITERALS(l, dp, r)				\
     for (l = r->d < 0 ? -r->d - 1 : r->d,			\
-         dp = !l ? &r->w2 : pool->whatprovidesdata + l,		\
+         dp = !l ? &r->w2 : solver_whatprovidesdata(solv, l),	\
          l = r->p; l; l = (dp != &r->w2 + 1 ? *dp++ : 0))
 
 /* iterate over all packages selected by a job */
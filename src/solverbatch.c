@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * solverbatch.c
+ *
+ * Solve many independent jobs on the same pool with multiple threads
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "solver.h"
+#include "pool.h"
+#include "util.h"
+
+struct batchdata {
+  Pool *pool;
+  Queue *jobs;
+  int njobs;
+  void (*setup)(Solver *solv, void *data);
+  void *setupdata;
+  Transaction *trans;
+  int *nproblems;
+
+  pthread_mutex_t lock;
+  int next;			/* next job to solve */
+};
+
+static Solver *
+solve_batch_job(struct batchdata *bd, Solver *solv, int i)
+{
+  /* reuse the solver of the last job, it keeps its buffers */
+  if (solv)
+    solver_reset_for_job(solv);
+  else
+    solv = solver_create(bd->pool);
+  if (bd->setup)
+    bd->setup(solv, bd->setupdata);
+  solver_solve(solv, bd->jobs + i);
+  if (bd->nproblems)
+    bd->nproblems[i] = solver_problem_count(solv);
+  if (bd->trans)
+    {
+      /* hand the transaction over to the caller */
+      bd->trans[i] = solv->trans;
+      transaction_init(&solv->trans, bd->pool);
+    }
+  return solv;
+}
+
+static void
+solve_batch_jobs(struct batchdata *bd)
+{
+  Solver *solv = 0;
+  int i;
+
+  for (;;)
+    {
+      pthread_mutex_lock(&bd->lock);
+      i = bd->next < bd->njobs ? bd->next++ : -1;
+      pthread_mutex_unlock(&bd->lock);
+      if (i < 0)
+	break;
+      solv = solve_batch_job(bd, solv, i);
+    }
+  if (solv)
+    solver_free(solv);
+}
+
+static void *
+solve_batch_thread(void *data)
+{
+  solve_batch_jobs(data);
+  pool_freetmpspace_thread();
+  return 0;
+}
+
+/*
+ * solver_solve_batch  - solve independent jobs concurrently
+ *
+ * every thread solves its jobs with one solver that is reset with
+ * solver_reset_for_job() between them, setup (if not NULL) is called
+ * to configure it before each job. The threads take the next unsolved job when they
+ * are done with one, so the results do not depend on the number of
+ * threads and are the same as solving the jobs one after the other.
+ * trans[i] gets the transaction of jobs[i] and must be freed with
+ * transaction_free(), nproblems[i] gets the number of problems. Both
+ * can be NULL.
+ * The pool is frozen while the jobs are solved, see pool_freeze().
+ * setup is called from the worker threads.
+ */
+
+void
+solver_solve_batch(Pool *pool, Queue *jobs, int njobs, int nthreads, void (*setup)(Solver *solv, void *data), void *setupdata, Transaction *trans, int *nproblems)
+{
+  struct batchdata bd;
+  Solver *solv = 0;
+  pthread_t *threads;
+  int i, nstarted, wasfrozen;
+  unsigned int now;
+
+  if (njobs <= 0)
+    return;
+  now = sat_timems(0);
+  memset(&bd, 0, sizeof(bd));
+  bd.pool = pool;
+  bd.jobs = jobs;
+  bd.njobs = njobs;
+  bd.setup = setup;
+  bd.setupdata = setupdata;
+  bd.trans = trans;
+  bd.nproblems = nproblems;
+  if (nthreads > njobs)
+    nthreads = njobs;
+  if (nthreads <= 1)
+    {
+      for (i = 0; i < njobs; i++)
+	solv = solve_batch_job(&bd, solv, i);
+      solver_free(solv);
+      POOL_DEBUG(SAT_DEBUG_STATS, "solver_solve_batch took %d ms for %d jobs\n", sat_timems(now), njobs);
+      return;
+    }
+
+  wasfrozen = pool->frozen;
+  if (!wasfrozen)
+    pool_freeze(pool);
+  pthread_mutex_init(&bd.lock, 0);
+  /* the calling thread is one of the workers */
+  threads = sat_calloc(nthreads - 1, sizeof(pthread_t));
+  for (nstarted = 0; nstarted < nthreads - 1; nstarted++)
+    if (pthread_create(threads + nstarted, 0, solve_batch_thread, &bd) != 0)
+      break;
+  solve_batch_jobs(&bd);
+  for (i = 0; i < nstarted; i++)
+    pthread_join(threads[i], 0);
+  sat_free(threads);
+  pthread_mutex_destroy(&bd.lock);
+  if (!wasfrozen)
+    {
+      /* free what the batch put in the calling thread's tmpspace. Not
+       * done if the caller froze the pool, it may still use strings
+       * from there */
+      pool_thaw(pool);
+      pool_freetmpspace_thread();
+    }
+  POOL_DEBUG(SAT_DEBUG_STATS, "solver_solve_batch took %d ms for %d jobs in %d threads\n", sat_timems(now), njobs, nstarted + 1);
+}
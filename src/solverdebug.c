@@ -186,12 +186,11 @@ solver_printrule(Solver *solv, int type, Rule *r)
 	}
       else
 	  /* every other which is in d */
-	v = solv->pool->whatprovidesdata[d + i - 1];
+	v = solver_whatprovidesdata(solv, d)[i - 1];
       if (v == ID_NULL)
 	break;
       solver_printruleelement(solv, type, r, v);
     }
-  POOL_DEBUG(type, "    next rules: %d %d\n", r->n1, r->n2);
 }
 
 void
@@ -249,11 +248,19 @@ void
 solver_printwatches(Solver *solv, int type)
 {
   Pool *pool = solv->pool;
-  int counter;
+  Watchlist *wl;
+  int counter, i;
 
   POOL_DEBUG(type, "Watches: \n");
   for (counter = -(pool->nsolvables - 1); counter < pool->nsolvables; counter++)
-    POOL_DEBUG(type, "    solvable [%d] -- rule [%d]\n", counter, solv->watches[counter + pool->nsolvables]);
+    {
+      wl = solv->watches + pool->nsolvables + counter;
+      for (i = wl->off + wl->count - 2; i >= wl->off; i -= 2)
+        POOL_DEBUG(type, "    solvable [%d] -- rule [%d] blocker [%d]\n", counter, solv->watchdata[i], solv->watchdata[i + 1]);
+      wl = solv->binwatches + pool->nsolvables + counter;
+      for (i = wl->off + wl->count - 2; i >= wl->off; i -= 2)
+        POOL_DEBUG(type, "    solvable [%d] -- binary rule [%d] implies [%d]\n", counter, solv->watchdata[i + 1], solv->watchdata[i]);
+    }
 }
 
 void
@@ -1044,3 +1051,22 @@ policy_illegal2str(Solver *solv, int illegal, Solvable *s, Solvable *rs)
     }
   return "unknown illegal change";
 }
+
+/*
+ * the statistics of the last solver_solve() call as a JSON object,
+ * times are in microseconds
+ */
+const char *
+solver_stats2json(Solver *solv)
+{
+  SolverStats *st = &solv->stats;
+  char *b = pool_alloctmpspace(solv->pool, 1024);
+
+  snprintf(b, 1024, "{\"time\": {\"total\": %u, \"rules\": %u, \"unify\": %u, \"sat\": %u, \"propagate\": %u, \"minimize\": %u, \"recommends\": %u, \"problems\": %u, \"transaction\": %u}, "
+	   "\"propagations\": %u, \"watchvisits\": %u, \"conflicts\": %u, \"learned\": %u, \"restarts\": %u, \"branches\": %u, "
+	   "\"rules_peakmem\": %u, \"watches_peakmem\": %u, \"rules\": %d, \"problems\": %d}",
+	   st->time_total, st->time_rules, st->time_unify, st->time_sat, st->time_propagate, st->time_minimize, st->time_recommends, st->time_problems, st->time_transaction,
+	   st->propagations, st->watchvisits, st->conflicts, st->learned, st->restarts, st->branches,
+	   st->rules_peakmem, st->watches_peakmem, solv->nrules - 1, solv->problems.count / 2);
+  return b;
+}
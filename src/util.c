@@ -98,6 +98,21 @@ sat_timems(unsigned int subtract)
   return r - subtract;
 }
 
+/* like sat_timems, but in microseconds. Wraps after about an hour,
+ * which is fine for measuring durations */
+unsigned int
+sat_timeus(unsigned int subtract)
+{
+  struct timeval tv;
+  unsigned int r;
+
+  if (gettimeofday(&tv, 0))
+    return 0;
+  r = (unsigned int)tv.tv_sec * 1000000U;
+  r += (unsigned int)tv.tv_usec;
+  return r - subtract;
+}
+
 /* bsd's qsort_r has different arguments, so we define our
    own version in case we need to do some clever mapping
 
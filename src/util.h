@@ -28,6 +28,7 @@ extern void *sat_realloc2(void *, size_t, size_t);
 extern void *sat_free(void *);
 extern void sat_oom(size_t, size_t);
 extern unsigned int sat_timems(unsigned int subtract);
+extern unsigned int sat_timeus(unsigned int subtract);
 extern void sat_sort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *, void *), void *compard);
 extern char *sat_dupjoin(const char *str1, const char *str2, const char *str3);
 extern char *sat_dupappend(const char *str1, const char *str2, const char *str3);
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * whatprovidescache.c
+ *
+ * Write the whatprovides data of a pool to a file and load it again,
+ * so that a program that always sets up the same pool does not have
+ * to create it on every start.
+ *
+ * Only the providers of the names are stored, the relation providers
+ * are computed on demand as usual. The data is written in native
+ * byte order, the file is meant to be a local cache.
+ *
+ * The ids in the data are only meaningful for a pool that was set up
+ * in exactly the same way. The file contains a checksum over the
+ * layout of the pool (solvables, repos, strings, architectures), the
+ * content of the repos must be described by the cookie given by the
+ * caller.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+#include "repo.h"
+#include "poolid_private.h"
+#include "chksum.h"
+#include "util.h"
+#include "whatprovidescache.h"
+
+#define WHATPROVIDESCACHE_VERSION	1
+#define WHATPROVIDESCACHE_BYTEORDER	0x01020304
+
+#define WHATPROVIDESCACHE_ERROR_NOT_CACHE	1
+#define WHATPROVIDESCACHE_ERROR_UNSUPPORTED	2
+#define WHATPROVIDESCACHE_ERROR_EOF		3
+#define WHATPROVIDESCACHE_ERROR_MISMATCH	4
+#define WHATPROVIDESCACHE_ERROR_CORRUPT		5
+#define WHATPROVIDESCACHE_ERROR_WRITE		6
+
+struct whatprovidescacheheader {
+  char magic[4];
+  unsigned int byteorder;
+  unsigned int version;
+  unsigned char cookie[32];
+  unsigned char fingerprint[32];
+  unsigned int nstrings;
+  unsigned int ndata;		/* entries of the provider data */
+  unsigned int mapsize;		/* bytes of the map of indexed solvables */
+};
+
+/* checksum over everything the whatprovides data depends on,
+ * except the content of the repos */
+static void
+whatprovides_fingerprint(Pool *pool, unsigned char *out)
+{
+  void *chk;
+  Repo *repo;
+  Id buf[6];
+  int i;
+
+  chk = sat_chksum_create(REPOKEY_TYPE_SHA256);
+  buf[0] = pool->nsolvables;
+  buf[1] = pool->ss.nstrings;
+  buf[2] = pool->ss.sstrings;
+  buf[3] = pool->nrepos;
+  buf[4] = pool->installed ? pool->installed->repoid : 0;
+  buf[5] = pool->id2arch ? pool->lastarch : -1;
+  sat_chksum_add(chk, buf, sizeof(buf));
+  if (pool->id2arch)
+    sat_chksum_add(chk, pool->id2arch, (pool->lastarch + 1) * sizeof(Id));
+  if (pool->considered)
+    sat_chksum_add(chk, pool->considered->map, pool->considered->size);
+  FOR_REPOS(i, repo)
+    {
+      buf[0] = repo->repoid;
+      buf[1] = repo->start;
+      buf[2] = repo->end;
+      buf[3] = repo->nsolvables;
+      buf[4] = repo->idarraysize;
+      buf[5] = repo->disabled;
+      sat_chksum_add(chk, buf, sizeof(buf));
+    }
+  sat_chksum_free(chk, out);
+}
+
+int
+pool_writewhatprovides(Pool *pool, FILE *fp, const unsigned char *cookie)
+{
+  struct whatprovidescacheheader hdr;
+  Offset *whatprovides, *newoff, o, ndata;
+  Id *data, *dp;
+  Id id;
+  int r = 0;
+
+  if (!pool->whatprovides || pool->whatprovidesstale)
+    pool_createwhatprovides(pool);
+
+  /* copy the name lists, lists shared by some names stay shared */
+  whatprovides = sat_calloc(pool->ss.nstrings, sizeof(Offset));
+  newoff = sat_calloc(pool->whatprovidesdataoff, sizeof(Offset));
+  data = sat_malloc2(pool->whatprovidesdataoff, sizeof(Id));
+  data[0] = data[1] = 0;	/* first entry is undef, second is empty list */
+  ndata = 2;
+  for (id = 1; id < pool->ss.nstrings; id++)
+    {
+      o = pool->whatprovides[id];
+      if (o <= 1)
+	{
+	  whatprovides[id] = o;
+	  continue;
+	}
+      if (!newoff[o])
+	{
+	  newoff[o] = ndata;
+	  for (dp = pool->whatprovidesdata + o; *dp; dp++)
+	    data[ndata++] = *dp;
+	  data[ndata++] = 0;
+	}
+      whatprovides[id] = newoff[o];
+    }
+  sat_free(newoff);
+
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, "SWPC", 4);
+  hdr.byteorder = WHATPROVIDESCACHE_BYTEORDER;
+  hdr.version = WHATPROVIDESCACHE_VERSION;
+  if (cookie)
+    memcpy(hdr.cookie, cookie, sizeof(hdr.cookie));
+  whatprovides_fingerprint(pool, hdr.fingerprint);
+  hdr.nstrings = pool->ss.nstrings;
+  hdr.ndata = ndata;
+  hdr.mapsize = (pool->nsolvables + 7) >> 3;	/* the map may be bigger if the pool shrunk */
+  if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1
+      || fwrite(whatprovides, sizeof(Offset), hdr.nstrings, fp) != hdr.nstrings
+      || fwrite(data, sizeof(Id), ndata, fp) != ndata
+      || (hdr.mapsize && fwrite(pool->whatprovidesmap.map, hdr.mapsize, 1, fp) != 1))
+    {
+      pool_debug(pool, SAT_ERROR, "whatprovides cache: write error\n");
+      r = WHATPROVIDESCACHE_ERROR_WRITE;
+    }
+  sat_free(whatprovides);
+  sat_free(data);
+  return r;
+}
+
+int
+pool_loadwhatprovides(Pool *pool, FILE *fp, const unsigned char *cookie)
+{
+  struct whatprovidescacheheader hdr;
+  unsigned char fingerprint[32], nocookie[32];
+  Offset *whatprovides = 0;
+  Id *data = 0, *dp;
+  unsigned char *map = 0;
+  int i, extra;
+  Repo *repo;
+  Id id;
+
+  POOL_CHECK_THAWED(pool);
+  if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+    return WHATPROVIDESCACHE_ERROR_EOF;
+  if (memcmp(hdr.magic, "SWPC", 4))
+    {
+      pool_debug(pool, SAT_ERROR, "whatprovides cache: not a whatprovides cache\n");
+      return WHATPROVIDESCACHE_ERROR_NOT_CACHE;
+    }
+  if (hdr.byteorder != WHATPROVIDESCACHE_BYTEORDER || hdr.version != WHATPROVIDESCACHE_VERSION)
+    {
+      POOL_DEBUG(SAT_DEBUG_STATS, "whatprovides cache: unsupported version\n");
+      return WHATPROVIDESCACHE_ERROR_UNSUPPORTED;
+    }
+  if (!cookie)
+    {
+      memset(nocookie, 0, sizeof(nocookie));
+      cookie = nocookie;
+    }
+  whatprovides_fingerprint(pool, fingerprint);
+  if (memcmp(hdr.cookie, cookie, sizeof(hdr.cookie)) || memcmp(hdr.fingerprint, fingerprint, sizeof(fingerprint)) || hdr.nstrings != pool->ss.nstrings || hdr.mapsize != (pool->nsolvables + 7) >> 3)
+    {
+      POOL_DEBUG(SAT_DEBUG_STATS, "whatprovides cache: made for a different pool\n");
+      return WHATPROVIDESCACHE_ERROR_MISMATCH;
+    }
+  if (hdr.ndata < 2)
+    {
+      pool_debug(pool, SAT_ERROR, "whatprovides cache: corrupt data\n");
+      return WHATPROVIDESCACHE_ERROR_CORRUPT;
+    }
+
+  /* reserve some space for relation data */
+  extra = 2 * pool->nrels;
+  if (extra < 256)
+    extra = 256;
+  whatprovides = sat_calloc_block(hdr.nstrings, sizeof(Offset), WHATPROVIDES_BLOCK);
+  data = sat_calloc(hdr.ndata + extra, sizeof(Id));
+  map = hdr.mapsize ? sat_malloc(hdr.mapsize) : 0;
+  if (fread(whatprovides, sizeof(Offset), hdr.nstrings, fp) != hdr.nstrings
+      || fread(data, sizeof(Id), hdr.ndata, fp) != hdr.ndata
+      || (hdr.mapsize && fread(map, hdr.mapsize, 1, fp) != 1))
+    {
+      pool_debug(pool, SAT_ERROR, "whatprovides cache: unexpected EOF\n");
+      sat_free(whatprovides);
+      sat_free(data);
+      sat_free(map);
+      return WHATPROVIDESCACHE_ERROR_EOF;
+    }
+
+  /* make sure we do not crash on a broken file */
+  for (id = 0; id < hdr.nstrings; id++)
+    if (whatprovides[id] >= hdr.ndata)
+      break;
+  for (dp = data; id == hdr.nstrings && dp < data + hdr.ndata; dp++)
+    if (*dp < 0 || *dp >= pool->nsolvables)
+      break;
+  if (id != hdr.nstrings || dp != data + hdr.ndata || data[hdr.ndata - 1] != 0)
+    {
+      pool_debug(pool, SAT_ERROR, "whatprovides cache: corrupt data\n");
+      sat_free(whatprovides);
+      sat_free(data);
+      sat_free(map);
+      return WHATPROVIDESCACHE_ERROR_CORRUPT;
+    }
+
+  pool_freewhatprovides(pool);
+  pool->whatprovides = whatprovides;
+  pool->whatprovides_rel = sat_calloc_block(pool->nrels, sizeof(Offset), WHATPROVIDES_BLOCK);
+  pool->whatprovidesdata = data;
+  pool->whatprovidesdataoff = hdr.ndata;
+  pool->whatprovidesdataleft = extra;
+  pool->whatprovidesmap.map = map;
+  pool->whatprovidesmap.size = hdr.mapsize;
+  FOR_REPOS(i, repo)
+    repo->whatprovidessize = repo->idarraysize;
+  pool->whatprovidesnstrings = pool->ss.nstrings;
+  pool->whatprovidesnrels = pool->nrels;
+  POOL_DEBUG(SAT_DEBUG_STATS, "loaded whatprovides cache: %d ids, %d data entries\n", hdr.nstrings, hdr.ndata);
+  return 0;
+}
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * whatprovidescache.h
+ *
+ * store the whatprovides data of a pool in a file
+ */
+
+#ifndef SATSOLVER_WHATPROVIDESCACHE_H
+#define SATSOLVER_WHATPROVIDESCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#include "pool.h"
+
+/* cookie: 32 bytes describing the content of the repos, e.g. a
+ * checksum over the cookies of the repo cache files. May be 0. */
+extern int pool_writewhatprovides(Pool *pool, FILE *fp, const unsigned char *cookie);
+/* returns 0 if the data was loaded. The file is only used if the
+ * cookie is the same and the pool looks like the one that was written.
+ * Otherwise the whatprovides data of the pool is not touched. */
+extern int pool_loadwhatprovides(Pool *pool, FILE *fp, const unsigned char *cookie);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SATSOLVER_WHATPROVIDESCACHE_H */
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * benchutil.c
+ *
+ * pool generators and job makers shared by the benchmarks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "repo_solv.h"
+#include "solver.h"
+#include "util.h"
+#include "benchutil.h"
+
+static unsigned int seed = 1;
+
+/* simple LCG, so that the synthetic pools are the same on every run */
+unsigned int
+bench_rnd(unsigned int n)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 8) % n;
+}
+
+/* add a solv file as new repo, exits on error */
+Repo *
+bench_readsolv(Pool *pool, const char *filename)
+{
+  Repo *repo;
+  FILE *fp;
+
+  if ((fp = fopen(filename, "r")) == 0)
+    {
+      perror(filename);
+      exit(1);
+    }
+  repo = repo_create(pool, filename);
+  if (repo_add_solv(repo, fp))
+    {
+      fprintf(stderr, "%s: could not read repository\n", filename);
+      exit(1);
+    }
+  fclose(fp);
+  return repo;
+}
+
+/* add all solv files, returns the first repo, meant to be the
+ * installed one */
+Repo *
+bench_readrepos(Pool *pool, int nfiles, char **filenames)
+{
+  Repo *first = 0, *repo;
+  int i;
+
+  for (i = 0; i < nfiles; i++)
+    {
+      repo = bench_readsolv(pool, filenames[i]);
+      if (!first)
+	first = repo;
+    }
+  return first;
+}
+
+/*
+ * every package in two versions, the old one is installed for half
+ * of them. Package j is version j & 1 of "pkg<j / 2>", it provides
+ * itself. adddeps adds the benchmark's dependencies, it may also
+ * rename the package.
+ */
+void
+bench_fillrepos(Pool *pool, Repo *installed, Repo *available, int nsolvables,
+		void (*adddeps)(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs))
+{
+  Id evrs[2], p;
+  Repo *repo;
+  Solvable *s;
+  char buf[64];
+  int i, j, npkgs = (nsolvables + 1) / 2;
+
+  evrs[0] = str2id(pool, "1.0-1", 1);
+  evrs[1] = str2id(pool, "1.1-1", 1);
+  for (i = 0; i < nsolvables + npkgs / 2; i++)
+    {
+      j = i < nsolvables ? i : 2 * (i - nsolvables);
+      repo = i < nsolvables ? available : installed;
+      p = repo_add_solvable(repo);
+      s = pool->solvables + p;
+      sprintf(buf, "pkg%d", j / 2);
+      s->name = str2id(pool, buf, 1);
+      s->evr = evrs[j & 1];
+      s->arch = ARCH_NOARCH;
+      if (adddeps)
+	adddeps(pool, repo, s, j, npkgs, evrs);
+      s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, s->name, s->evr, REL_EQ, 1), 0);
+    }
+}
+
+static Id
+randomavailable(Pool *pool)
+{
+  Solvable *s;
+  Id p;
+
+  do
+    {
+      p = 2 + bench_rnd(pool->nsolvables - 2);
+      s = pool->solvables + p;
+    }
+  while (!s->repo || s->repo == pool->installed);
+  return s->name;
+}
+
+/* install jobs for the names of random not installed packages */
+Queue *
+bench_makejobs(Pool *pool, int njobs, int flags)
+{
+  Queue *jobs;
+  int i;
+
+  jobs = sat_calloc(njobs, sizeof(Queue));
+  for (i = 0; i < njobs; i++)
+    {
+      queue_init(jobs + i);
+      if ((flags & BENCH_JOBS_UPDATE) != 0 && i % 4 == 3)
+	{
+	  queue_push2(jobs + i, SOLVER_UPDATE | SOLVER_SOLVABLE_ALL, 0);
+	  continue;
+	}
+      queue_push2(jobs + i, SOLVER_INSTALL | SOLVER_SOLVABLE_NAME, randomavailable(pool));
+      if ((flags & BENCH_JOBS_ERASE) != 0)
+	queue_push2(jobs + i, SOLVER_ERASE | SOLVER_SOLVABLE_NAME, randomavailable(pool));
+    }
+  return jobs;
+}
+
+void
+bench_freejobs(Queue *jobs, int njobs)
+{
+  int i;
+
+  for (i = 0; i < njobs; i++)
+    queue_free(jobs + i);
+  sat_free(jobs);
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * benchutil.h
+ *
+ * pool generators and job makers shared by the benchmarks
+ */
+
+#ifndef SATSOLVER_BENCHUTIL_H
+#define SATSOLVER_BENCHUTIL_H
+
+#include "pool.h"
+#include "repo.h"
+#include "queue.h"
+
+/* makejobs flags */
+#define BENCH_JOBS_UPDATE	(1 << 0)	/* every fourth job updates all packages */
+#define BENCH_JOBS_ERASE	(1 << 1)	/* install jobs also erase a package */
+
+extern unsigned int bench_rnd(unsigned int n);
+
+extern Repo *bench_readsolv(Pool *pool, const char *filename);
+extern Repo *bench_readrepos(Pool *pool, int nfiles, char **filenames);
+
+extern void bench_fillrepos(Pool *pool, Repo *installed, Repo *available, int nsolvables,
+			    void (*adddeps)(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs));
+extern Queue *bench_makejobs(Pool *pool, int njobs, int flags);
+extern void bench_freejobs(Queue *jobs, int njobs);
+
+#endif /* SATSOLVER_BENCHUTIL_H */
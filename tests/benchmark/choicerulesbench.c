@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * choicerulesbench
+ *
+ * times solver_addchoicerules(), which caches the installed package
+ * a provider updates, against a copy of the old code that looks it
+ * up for every rule the provider appears in. Both must create the
+ * same choice rules.
+ *
+ * Usage:
+ *   choicerulesbench [-n <solvables>] [-j <jobs>] [-r <rounds>]
+ *   choicerulesbench [-j <jobs>] [-r <rounds>] <installed solv> <solv files...>
+ *
+ * Without solv files a synthetic pool is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "solver.h"
+#include "policy.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* packages provide capabilities that other packages require, some
+ * only in the new version. Some packages get renamed and obsolete the
+ * old name */
+static void
+adddeps(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs)
+{
+  Id dep;
+  char buf[64];
+  int ncaps = npkgs / 4 + 1;
+
+  if ((j & 1) != 0 && (j / 2) % 10 == 5)
+    {
+      /* renamed in the new version */
+      s->obsoletes = repo_addid_dep(repo, s->obsoletes, s->name, 0);
+      sprintf(buf, "newpkg%d", j / 2);
+      s->name = str2id(pool, buf, 1);
+    }
+  if ((j & 1) != 0 || (j / 2) % 3 != 0)
+    {
+      /* only the new version provides it for a third of the packages */
+      sprintf(buf, "cap%d", (j / 2) % ncaps);
+      s->provides = repo_addid_dep(repo, s->provides, str2id(pool, buf, 1), 0);
+    }
+  if (j >= 8)
+    {
+      sprintf(buf, "cap%d", bench_rnd(j / 2) % ncaps);
+      s->requires = repo_addid_dep(repo, s->requires, str2id(pool, buf, 1), 0);
+      sprintf(buf, "pkg%d", bench_rnd(j / 2));
+      dep = rel2id(pool, str2id(pool, buf, 1), evrs[0], REL_GT | REL_EQ, 1);
+      s->requires = repo_addid_dep(repo, s->requires, dep, 0);
+    }
+}
+
+/*
+ * solver_addchoicerules() before the update cache was added: the
+ * installed package a provider updates is looked up for every rule
+ * the provider appears in.
+ */
+static void
+addchoicerules_nocache(Solver *solv)
+{
+  Pool *pool = solv->pool;
+  Map m, mneg;
+  Rule *r;
+  Queue q, qi;
+  int i, j, rid, havechoice;
+  Id p, d, *pp;
+  Id p2, pp2;
+  Solvable *s, *s2;
+
+  solv->choicerules = solv->nrules;
+  if (!pool->installed)
+    {
+      solv->choicerules_end = solv->nrules;
+      return;
+    }
+  solv->choicerules_ref = sat_calloc(solv->rpmrules_end, sizeof(Id));
+  queue_init(&q);
+  queue_init(&qi);
+  map_init(&m, pool->nsolvables);
+  map_init(&mneg, pool->nsolvables);
+  /* set up negative assertion map from infarch and dup rules */
+  for (rid = solv->infarchrules, r = solv->rules + rid; rid < solv->infarchrules_end; rid++, r++)
+    if (r->p < 0 && !r->w2 && (r->d == 0 || r->d == -1))
+      MAPSET(&mneg, -r->p);
+  for (rid = solv->duprules, r = solv->rules + rid; rid < solv->duprules_end; rid++, r++)
+    if (r->p < 0 && !r->w2 && (r->d == 0 || r->d == -1))
+      MAPSET(&mneg, -r->p);
+  for (rid = 1; rid < solv->rpmrules_end ; rid++)
+    {
+      r = solv->rules + rid;
+      if (r->p >= 0 || ((r->d == 0 || r->d == -1) && r->w2 < 0))
+	continue;	/* only look at requires rules */
+      queue_empty(&q);
+      queue_empty(&qi);
+      havechoice = 0;
+      FOR_RULELITERALS(p, pp, r)
+	{
+	  if (p < 0)
+	    continue;
+	  s = pool->solvables + p;
+	  if (!s->repo)
+	    continue;
+	  if (s->repo == pool->installed)
+	    {
+	      queue_push(&q, p);
+	      continue;
+	    }
+	  /* check if this package is "blocked" by a installed package */
+	  s2 = 0;
+	  FOR_PROVIDES(p2, pp2, s->name)
+	    {
+	      s2 = pool->solvables + p2;
+	      if (s2->repo != pool->installed)
+		continue;
+	      if (!pool->implicitobsoleteusesprovides && s->name != s2->name)
+		continue;
+	      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
+		continue;
+	      break;
+	    }
+	  if (p2)
+	    {
+	      /* found installed package p2 that we can update to p */
+	      if (MAPTST(&mneg, p))
+		continue;
+	      if (policy_is_illegal(solv, s2, s, 0))
+		continue;
+	      queue_push(&qi, p2);
+	      queue_push(&q, p);
+	      continue;
+	    }
+	  if (s->obsoletes)
+	    {
+	      Id obs, *obsp = s->repo->idarraydata + s->obsoletes;
+	      s2 = 0;
+	      while ((obs = *obsp++) != 0)
+		{
+		  FOR_PROVIDES(p2, pp2, obs)
+		    {
+		      s2 = pool->solvables + p2;
+		      if (s2->repo != pool->installed)
+			continue;
+		      if (!pool->obsoleteusesprovides && !pool_match_nevr(pool, pool->solvables + p2, obs))
+			continue;
+		      if (pool->obsoleteusescolors && !pool_colormatch(pool, s, s2))
+			continue;
+		      break;
+		    }
+		  if (p2)
+		    break;
+		}
+	      if (obs)
+		{
+		  /* found installed package p2 that we can update to p */
+		  if (MAPTST(&mneg, p))
+		    continue;
+		  if (policy_is_illegal(solv, s2, s, 0))
+		    continue;
+		  queue_push(&qi, p2);
+		  queue_push(&q, p);
+		  continue;
+		}
+	    }
+	  /* package p is independent of the installed ones */
+	  havechoice = 1;
+	}
+      if (!havechoice || !q.count)
+	continue;	/* no choice */
+
+      /* now check the update rules of the installed package.
+       * if all packages of the update rules are contained in
+       * the dependency rules, there's no need to set up the choice rule */
+      map_empty(&m);
+      FOR_RULELITERALS(p, pp, r)
+        if (p > 0)
+	  MAPSET(&m, p);
+      for (i = 0; i < qi.count; i++)
+	{
+	  Rule *ur;
+	  if (!qi.elements[i])
+	    continue;
+	  ur = solv->rules + solv->updaterules + (qi.elements[i] - pool->installed->start);
+	  if (!ur->p)
+	    ur = solv->rules + solv->featurerules + (qi.elements[i] - pool->installed->start);
+	  if (!ur->p)
+	    continue;
+	  FOR_RULELITERALS(p, pp, ur)
+	    if (!MAPTST(&m, p))
+	      break;
+	  if (p)
+	    break;
+	  for (j = i + 1; j < qi.count; j++)
+	    if (qi.elements[i] == qi.elements[j])
+	      qi.elements[j] = 0;
+	}
+      if (i == qi.count)
+	continue;
+      d = q.count ? solver_queuetowhatprovides(solv, &q) : 0;
+      solver_addrule(solv, r->p, d);
+      queue_push(&solv->weakruleq, solv->nrules - 1);
+      solv->choicerules_ref[solv->nrules - 1 - solv->choicerules] = rid;
+    }
+  queue_free(&q);
+  queue_free(&qi);
+  map_free(&m);
+  map_free(&mneg);
+  solv->choicerules_end = solv->nrules;
+}
+
+/*
+ * create the choice rules of a solved job again, append them with
+ * their origin rule to 'out' and remove them from the solver.
+ * returns the time in ms.
+ */
+static unsigned int
+makechoicerules(Solver *solv, int cached, Queue *out)
+{
+  Id choicerules = solv->choicerules, choicerules_end = solv->choicerules_end;
+  Id *choicerules_ref = solv->choicerules_ref;
+  int nrules = solv->nrules, nweak = solv->weakruleq.count;
+  int naux = solv->nwhatprovidesauxdata;
+  unsigned int now;
+  Rule *r;
+  Id rid, p, *pp;
+
+  now = sat_timems(0);
+  if (cached)
+    solver_addchoicerules(solv);
+  else
+    addchoicerules_nocache(solv);
+  now = sat_timems(now);
+  for (rid = solv->choicerules; rid < solv->choicerules_end; rid++)
+    {
+      r = solv->rules + rid;
+      queue_push(out, solv->choicerules_ref[rid - solv->choicerules]);
+      FOR_RULELITERALS(p, pp, r)
+	queue_push(out, p);
+      queue_push(out, 0);
+    }
+  sat_free(solv->choicerules_ref);
+  solv->choicerules = choicerules;
+  solv->choicerules_end = choicerules_end;
+  solv->choicerules_ref = choicerules_ref;
+  solv->nrules = nrules;
+  solv->weakruleq.count = nweak;
+  solv->nwhatprovidesauxdata = naux;
+  return now;
+}
+
+int
+main(int argc, char **argv)
+{
+  Pool *pool;
+  Repo *installed, *repo;
+  Solver *solv;
+  Queue *jobs, q1, q2;
+  int c, i, r, nchoice;
+  int nsolvables = 20000, njobs = 8, rounds = 3;
+  unsigned int ms1 = 0, ms2 = 0;
+
+  while ((c = getopt(argc, argv, "n:j:r:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 'j':
+	  njobs = atoi(optarg);
+	  break;
+	case 'r':
+	  rounds = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: choicerulesbench [-n <solvables>] [-j <jobs>] [-r <rounds>] [<installed solv> <solv files...>]\n");
+	  exit(1);
+	}
+    }
+  if (nsolvables < 16)
+    nsolvables = 16;
+  if (njobs <= 0)
+    njobs = 1;
+  if (rounds <= 0)
+    rounds = 1;
+
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  if (optind < argc)
+    installed = bench_readrepos(pool, argc - optind, argv + optind);
+  else
+    {
+      installed = repo_create(pool, "installed");
+      repo = repo_create(pool, "available");
+      bench_fillrepos(pool, installed, repo, nsolvables, adddeps);
+    }
+  pool_set_installed(pool, installed);
+  pool_addfileprovides(pool);
+  pool_createwhatprovides(pool);
+  pool_freeze(pool);
+
+  jobs = bench_makejobs(pool, njobs, BENCH_JOBS_UPDATE);
+  queue_init(&q1);
+  queue_init(&q2);
+  nchoice = 0;
+  for (i = 0; i < njobs; i++)
+    {
+      solv = solver_create(pool);
+      solver_solve(solv, jobs + i);
+      nchoice += solv->choicerules_end - solv->choicerules;
+      for (r = 0; r < rounds; r++)
+	{
+	  queue_empty(&q1);
+	  queue_empty(&q2);
+	  ms1 += makechoicerules(solv, 0, &q1);
+	  ms2 += makechoicerules(solv, 1, &q2);
+	  if (q1.count != q2.count || memcmp(q1.elements, q2.elements, q1.count * sizeof(Id)) != 0)
+	    {
+	      fprintf(stderr, "job %d: the choice rules differ\n", i);
+	      exit(1);
+	    }
+	}
+      solver_free(solv);
+    }
+  printf("%d solvables, %d installed, %d jobs, %d choice rules\n", pool->nsolvables, installed->nsolvables, njobs, nchoice);
+  printf("without cache: %u ms  with cache: %u ms\n", ms1, ms2);
+  bench_freejobs(jobs, njobs);
+  queue_free(&q1);
+  queue_free(&q2);
+  pool_free(pool);
+  return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * evrcmpbench
+ *
+ * measures the evr comparisons per second with and without the evr
+ * rank table and checks that both give the same results. All pairs
+ * of a fixed set of evrs with odd releases are checked, too.
+ *
+ * Usage:
+ *   evrcmpbench [-n <solvables>] [-c <comparisons>] [solv files...]
+ *
+ * Without solv files a synthetic repo is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "evr.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* evrs with optional epochs, alpha parts and (empty) releases */
+static void
+fillrepo(Pool *pool, Repo *repo, int nsolvables)
+{
+  static const char *suffixes[] = { "", "", "", "a", "b", "rc1", "pre", ".1" };
+  Id p, name, evr;
+  Solvable *s;
+  char buf[64], *bp;
+  int i;
+
+  for (i = 0; i < nsolvables; i++)
+    {
+      p = repo_add_solvable(repo);
+      s = pool->solvables + p;
+      bp = buf;
+      if (bench_rnd(10) == 0)
+	bp += sprintf(bp, "%u:", bench_rnd(3));
+      bp += sprintf(bp, "%u.%u", bench_rnd(5), bench_rnd(20));
+      if (bench_rnd(2))
+	bp += sprintf(bp, ".%u", bench_rnd(30));
+      bp += sprintf(bp, "%s", suffixes[bench_rnd(8)]);
+      if (bench_rnd(8) != 0)
+	sprintf(bp, "-%u.%u", bench_rnd(50), bench_rnd(3));
+      else if (bench_rnd(4) == 0)
+	sprintf(bp, "-");
+      evr = str2id(pool, buf, 1);
+      sprintf(buf, "pkg%d", i / 4);
+      name = str2id(pool, buf, 1);
+      s->name = name;
+      s->evr = evr;
+      s->arch = ARCH_NOARCH;
+      s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, name, evr, REL_EQ, 1), 0);
+    }
+}
+
+/* evrs the rank table must not get wrong, e.g. because an empty
+ * release compares equal to any release */
+static const char *trickyevrs[] = {
+  "0:1-0.", "0:1-", "0:1", "1", "1-", "1-0", "1-0.", "1-1", "1.", "1_",
+  "0:10-bb", "0:10-b1", "0:10-b", "0:10-", "10-ba", "10-b.1", "10",
+  "1.0", "1.0-", "1.0-1", "1.0-2", "1.0-1.", "1.0-a", "01.0-1", "1.00-1",
+  "1.0a-1", "1.0.a-1", "1.0_a-1", "1:0-", "1:0", "00:1.0-", "2-", "2-0",
+  0
+};
+
+static void
+addtricky(Pool *pool, Repo *repo)
+{
+  Solvable *s;
+  Id name;
+  int i;
+
+  name = str2id(pool, "tricky", 1);
+  for (i = 0; trickyevrs[i]; i++)
+    {
+      s = pool->solvables + repo_add_solvable(repo);
+      s->name = name;
+      s->evr = str2id(pool, trickyevrs[i], 1);
+      s->arch = ARCH_NOARCH;
+    }
+}
+
+/* compare all pairs of the tricky evrs with and without the table */
+static int
+checktricky(Pool *pool, const int *modes, const char **modenames)
+{
+  const char *evr1, *evr2;
+  int i, j, m, r1, r2, bad = 0;
+
+  for (m = 0; m < 3; m++)
+    for (i = 0; trickyevrs[i]; i++)
+      for (j = 0; trickyevrs[j]; j++)
+	{
+	  evr1 = trickyevrs[i];
+	  evr2 = trickyevrs[j];
+	  r1 = pool_evrcmp_str(pool, evr1, evr2, modes[m]);
+	  r2 = pool_evrcmp(pool, str2id(pool, evr1, 0), str2id(pool, evr2, 0), modes[m]);
+	  if (r1 != r2)
+	    {
+	      fprintf(stderr, "%s: %s %s: %d with ranks, %d without\n", modenames[m], evr1, evr2, r2, r1);
+	      bad = 1;
+	    }
+	}
+  return !bad;
+}
+
+/* compare the pairs, returns the time in ms */
+static unsigned int
+run(Pool *pool, Id *pairs, int npairs, int mode, int *results)
+{
+  unsigned int now;
+  int i;
+
+  now = sat_timems(0);
+  for (i = 0; i < npairs; i++)
+    results[i] = pool_evrcmp(pool, pairs[2 * i], pairs[2 * i + 1], mode);
+  return sat_timems(now);
+}
+
+static double
+persec(int n, unsigned int ms)
+{
+  return ms ? n * 1000.0 / ms : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  static const int modes[] = { EVRCMP_COMPARE, EVRCMP_MATCH_RELEASE, EVRCMP_COMPARE_EVONLY };
+  static const char *modenames[] = { "compare", "match_release", "compare_evonly" };
+  Pool *pool;
+  Repo *repo;
+  Id *evrs, *pairs, p;
+  int *res1, *res2;
+  int c, i, m, nevrs, nsolvables = 100000, npairs = 10000000;
+  unsigned int ms1, ms2, now;
+
+  while ((c = getopt(argc, argv, "n:c:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 'c':
+	  npairs = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: evrcmpbench [-n <solvables>] [-c <comparisons>] [solv files...]\n");
+	  exit(1);
+	}
+    }
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  if (optind < argc)
+    bench_readrepos(pool, argc - optind, argv + optind);
+  else
+    {
+      repo = repo_create(pool, "synthetic");
+      fillrepo(pool, repo, nsolvables);
+    }
+  addtricky(pool, repo_create(pool, "tricky"));
+  if (npairs <= 0)
+    npairs = 1;
+
+  evrs = sat_malloc2(pool->nsolvables, sizeof(Id));
+  nevrs = 0;
+  for (p = 2; p < pool->nsolvables; p++)
+    if (pool->solvables[p].repo)
+      evrs[nevrs++] = pool->solvables[p].evr;
+  if (!nevrs)
+    {
+      fprintf(stderr, "no solvables\n");
+      exit(1);
+    }
+  pairs = sat_malloc2(npairs, 2 * sizeof(Id));
+  for (i = 0; i < 2 * npairs; i++)
+    pairs[i] = evrs[bench_rnd(nevrs)];
+  res1 = sat_malloc2(npairs, sizeof(int));
+  res2 = sat_malloc2(npairs, sizeof(int));
+
+  now = sat_timems(0);
+  pool_createevrranks(pool);
+  printf("%d solvables, %d ids, rank table created in %u ms\n", pool->nsolvables, pool->ss.nstrings, sat_timems(now));
+  if (!checktricky(pool, modes, modenames))
+    exit(1);
+
+  for (m = 0; m < 3; m++)
+    {
+      pool_freeevrranks(pool);
+      ms1 = run(pool, pairs, npairs, modes[m], res1);
+      pool_createevrranks(pool);
+      ms2 = run(pool, pairs, npairs, modes[m], res2);
+      for (i = 0; i < npairs; i++)
+	if (res1[i] != res2[i])
+	  {
+	    fprintf(stderr, "%s: %s %s: %d with ranks, %d without\n", modenames[m], id2str(pool, pairs[2 * i]), id2str(pool, pairs[2 * i + 1]), res2[i], res1[i]);
+	    exit(1);
+	  }
+      printf("%-15s strings: %10.0f/s  ranks: %10.0f/s\n", modenames[m], persec(npairs, ms1), persec(npairs, ms2));
+    }
+  sat_free(evrs);
+  sat_free(pairs);
+  sat_free(res1);
+  sat_free(res2);
+  pool_free(pool);
+  return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * reusebench
+ *
+ * solves the same jobs over and over with one solver on a frozen
+ * pool and checks that the solver data does not grow from round to
+ * round. This is done with kept rpm rules (reuserpmrules), without
+ * them and with solver_reset_for_job() between the jobs.
+ * Then a repo is added to the pool and the solvers used so far must
+ * give the same results as fresh ones.
+ *
+ * Usage:
+ *   reusebench [-n <solvables>] [-j <jobs>] [-r <rounds>]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "solver.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* packages require and conflict with other packages */
+static void
+adddeps(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs)
+{
+  Id dep;
+  char buf[64];
+
+  if (j < 8)
+    return;
+  sprintf(buf, "pkg%d", bench_rnd(j / 2));
+  s->requires = repo_addid_dep(repo, s->requires, str2id(pool, buf, 1), 0);
+  sprintf(buf, "pkg%d", bench_rnd(j / 2));
+  dep = rel2id(pool, str2id(pool, buf, 1), evrs[1], bench_rnd(2) ? REL_GT | REL_EQ : REL_LT, 1);
+  if (bench_rnd(4) == 0)
+    s->conflicts = repo_addid_dep(repo, s->conflicts, dep, 0);
+  else
+    s->requires = repo_addid_dep(repo, s->requires, dep, 0);
+}
+
+/* solve all jobs for some rounds, returns 0 if the solver data grew */
+static int
+run(Pool *pool, Queue *jobs, int njobs, int rounds, int mode)
+{
+  static const char *modenames[] = { "reuserpmrules", "plain", "reset_for_job" };
+  Solver *solv;
+  int *auxsize, *nrules;
+  int i, r, ok = 1;
+  unsigned int now;
+
+  auxsize = sat_calloc(njobs, sizeof(int));
+  nrules = sat_calloc(njobs, sizeof(int));
+  solv = solver_create(pool);
+  solv->reuserpmrules = mode == 0;
+  now = sat_timems(0);
+  for (r = 0; r < rounds && ok; r++)
+    {
+      for (i = 0; i < njobs; i++)
+	{
+	  if (mode == 2)
+	    solver_reset_for_job(solv);
+	  solver_solve(solv, jobs + i);
+	  if (r == 0)
+	    {
+	      auxsize[i] = solv->nwhatprovidesauxdata;
+	      nrules[i] = solv->nrules;
+	    }
+	  else if (solv->nwhatprovidesauxdata != auxsize[i] || solv->nrules != nrules[i])
+	    {
+	      fprintf(stderr, "%s: job %d, round %d: %d rules, %d aux ids, first round: %d rules, %d aux ids\n", modenames[mode], i, r, solv->nrules, solv->nwhatprovidesauxdata, nrules[i], auxsize[i]);
+	      ok = 0;
+	      break;
+	    }
+	}
+    }
+  printf("%-15s %d jobs in %u ms, %d aux ids after the last job\n", modenames[mode], njobs * rounds, sat_timems(now), solv->nwhatprovidesauxdata);
+  solver_free(solv);
+  sat_free(auxsize);
+  sat_free(nrules);
+  return ok;
+}
+
+/* a newer version of every fourth available package */
+static void
+growpool(Pool *pool, Repo *available)
+{
+  Repo *repo = repo_create(pool, "update");
+  Id p, evr = str2id(pool, "1.2-1", 1);
+  Solvable *s, *os;
+  int i, n = available->end;
+
+  for (i = available->start; i < n; i += 4)
+    {
+      p = repo_add_solvable(repo);
+      s = pool->solvables + p;
+      os = pool->solvables + i;
+      s->name = os->name;
+      s->evr = evr;
+      s->arch = os->arch;
+      s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, s->name, evr, REL_EQ, 1), 0);
+    }
+}
+
+static int
+same_queue(Queue *q1, Queue *q2)
+{
+  int i;
+
+  if (q1->count != q2->count)
+    return 0;
+  for (i = 0; i < q1->count; i++)
+    if (q1->elements[i] != q2->elements[i])
+      return 0;
+  return 1;
+}
+
+/* keep using the solvers after the pool grew, returns 0 if a result
+ * differs from the one of a fresh solver */
+static int
+rungrow(Pool *pool, Repo *available, Queue *jobs, int njobs)
+{
+  static const char *modenames[] = { "reuserpmrules", "plain", "reset_for_job" };
+  Solver *solvs[3], *fsolv;
+  int i, mode, ok = 1;
+
+  for (mode = 0; mode < 3; mode++)
+    {
+      solvs[mode] = solver_create(pool);
+      solvs[mode]->reuserpmrules = mode == 0;
+      solver_solve(solvs[mode], jobs);
+    }
+  growpool(pool, available);
+  pool_createwhatprovides(pool);
+  for (i = 0; i < njobs; i++)
+    {
+      fsolv = solver_create(pool);
+      solver_solve(fsolv, jobs + i);
+      for (mode = 0; mode < 3; mode++)
+	{
+	  if (mode == 2)
+	    solver_reset_for_job(solvs[mode]);
+	  solver_solve(solvs[mode], jobs + i);
+	  if (!same_queue(&fsolv->decisionq, &solvs[mode]->decisionq) || !same_queue(&fsolv->problems, &solvs[mode]->problems))
+	    {
+	      fprintf(stderr, "%s: job %d differs from a fresh solver after the pool grew\n", modenames[mode], i);
+	      ok = 0;
+	    }
+	}
+      solver_free(fsolv);
+    }
+  printf("%-15s %d jobs after growing the pool to %d solvables\n", "grow", njobs, pool->nsolvables);
+  for (mode = 0; mode < 3; mode++)
+    solver_free(solvs[mode]);
+  return ok;
+}
+
+int
+main(int argc, char **argv)
+{
+  Pool *pool;
+  Repo *installed, *available;
+  Queue *jobs;
+  int c, mode, ok = 1;
+  int nsolvables = 5000, njobs = 10, rounds = 3;
+
+  while ((c = getopt(argc, argv, "n:j:r:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 'j':
+	  njobs = atoi(optarg);
+	  break;
+	case 'r':
+	  rounds = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: reusebench [-n <solvables>] [-j <jobs>] [-r <rounds>]\n");
+	  exit(1);
+	}
+    }
+  if (nsolvables < 16)
+    nsolvables = 16;
+  if (njobs <= 0)
+    njobs = 1;
+  if (rounds < 2)
+    rounds = 2;
+
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  installed = repo_create(pool, "installed");
+  available = repo_create(pool, "available");
+  bench_fillrepos(pool, installed, available, nsolvables, adddeps);
+  pool_set_installed(pool, installed);
+  pool_createwhatprovides(pool);
+  pool_freeze(pool);
+
+  jobs = bench_makejobs(pool, njobs, BENCH_JOBS_UPDATE | BENCH_JOBS_ERASE);
+  for (mode = 0; mode < 3; mode++)
+    if (!run(pool, jobs, njobs, rounds, mode))
+      ok = 0;
+  pool_thaw(pool);
+  if (!rungrow(pool, available, jobs, njobs))
+    ok = 0;
+  bench_freejobs(jobs, njobs);
+  pool_free(pool);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * solutionsbench
+ *
+ * times the solution refinement: a job that installs every n-th
+ * available package is solved, then all solutions of all problems
+ * are created. Creating the solutions must leave the decisions and
+ * recommendations of the solver run alone, and every round must find
+ * the same problems and solutions.
+ *
+ * Usage:
+ *   solutionsbench [-n <solvables>] [-e <every>] [-r <rounds>]
+ *   solutionsbench [-e <every>] [-r <rounds>] <installed solv> <solv files...>
+ *
+ * Without solv files a synthetic pool is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "solver.h"
+#include "problems.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* packages require and conflict with other packages, some of them
+ * require things nobody provides */
+static void
+adddeps(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs)
+{
+  Id dep;
+  char buf[64];
+
+  if (j < 8)
+    return;
+  sprintf(buf, "pkg%d", bench_rnd(j / 2));
+  dep = rel2id(pool, str2id(pool, buf, 1), evrs[0], REL_GT | REL_EQ, 1);
+  s->requires = repo_addid_dep(repo, s->requires, dep, 0);
+  if (bench_rnd(8) == 0)
+    {
+      sprintf(buf, "pkg%d", bench_rnd(npkgs));
+      s->conflicts = repo_addid_dep(repo, s->conflicts, str2id(pool, buf, 1), 0);
+    }
+  if ((j / 2) % 13 == 5)
+    {
+      sprintf(buf, "missing%d", j / 2);
+      s->requires = repo_addid_dep(repo, s->requires, str2id(pool, buf, 1), 0);
+    }
+}
+
+static int
+same_queue(Queue *q1, Queue *q2)
+{
+  int i;
+
+  if (q1->count != q2->count)
+    return 0;
+  for (i = 0; i < q1->count; i++)
+    if (q1->elements[i] != q2->elements[i])
+      return 0;
+  return 1;
+}
+
+/* create all solutions, returns the number of solutions and adds
+ * the number of solution elements to nelementsp */
+static int
+allsolutions(Solver *solv, int *nelementsp)
+{
+  Id problem, solution;
+  int nsolutions = 0;
+
+  for (problem = solver_next_problem(solv, 0); problem; problem = solver_next_problem(solv, problem))
+    {
+      nsolutions += solver_solution_count(solv, problem);
+      for (solution = solver_next_solution(solv, problem, 0); solution; solution = solver_next_solution(solv, problem, solution))
+	*nelementsp += solver_solutionelement_count(solv, problem, solution);
+    }
+  return nsolutions;
+}
+
+int
+main(int argc, char **argv)
+{
+  Pool *pool;
+  Repo *installed, *repo;
+  Solver *solv;
+  Solvable *s;
+  Queue job, decisions, recommendations;
+  Id p;
+  int c, r, n, nproblems, nsolutions, nelements;
+  int nsolvables = 20000, every = 20, rounds = 3;
+  int nproblems0 = 0, nsolutions0 = 0, nelements0 = 0;
+  unsigned int now, ms, solvems = 0, solms = 0;
+
+  while ((c = getopt(argc, argv, "n:e:r:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 'e':
+	  every = atoi(optarg);
+	  break;
+	case 'r':
+	  rounds = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: solutionsbench [-n <solvables>] [-e <every>] [-r <rounds>] [<installed solv> <solv files...>]\n");
+	  exit(1);
+	}
+    }
+  if (nsolvables < 16)
+    nsolvables = 16;
+  if (every <= 0)
+    every = 1;
+  if (rounds <= 0)
+    rounds = 1;
+
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  if (optind < argc)
+    installed = bench_readrepos(pool, argc - optind, argv + optind);
+  else
+    {
+      installed = repo_create(pool, "installed");
+      repo = repo_create(pool, "available");
+      bench_fillrepos(pool, installed, repo, nsolvables, adddeps);
+    }
+  pool_set_installed(pool, installed);
+  pool_addfileprovides(pool);
+  pool_createwhatprovides(pool);
+
+  queue_init(&job);
+  for (p = 2, n = 0; p < pool->nsolvables; p++)
+    {
+      s = pool->solvables + p;
+      if (!s->repo || s->repo == installed)
+	continue;
+      if (++n % every == 0)
+	queue_push2(&job, SOLVER_INSTALL | SOLVER_SOLVABLE_NAME, s->name);
+    }
+
+  queue_init(&decisions);
+  queue_init(&recommendations);
+  for (r = 0; r < rounds; r++)
+    {
+      solv = solver_create(pool);
+      now = sat_timems(0);
+      solver_solve(solv, &job);
+      ms = sat_timems(now);
+      if (!r || ms < solvems)
+	solvems = ms;
+      queue_free(&decisions);
+      queue_init_clone(&decisions, &solv->decisionq);
+      queue_free(&recommendations);
+      queue_init_clone(&recommendations, &solv->recommendations);
+
+      now = sat_timems(0);
+      nproblems = solver_problem_count(solv);
+      nelements = 0;
+      nsolutions = allsolutions(solv, &nelements);
+      ms = sat_timems(now);
+      if (!r || ms < solms)
+	solms = ms;
+
+      if (!same_queue(&decisions, &solv->decisionq) || !same_queue(&recommendations, &solv->recommendations))
+	{
+	  fprintf(stderr, "round %d: creating the solutions changed the solver state\n", r);
+	  exit(1);
+	}
+      if (!r)
+	{
+	  nproblems0 = nproblems;
+	  nsolutions0 = nsolutions;
+	  nelements0 = nelements;
+	}
+      else if (nproblems != nproblems0 || nsolutions != nsolutions0 || nelements != nelements0)
+	{
+	  fprintf(stderr, "round %d: %d problems, %d solutions, %d elements, first round: %d problems, %d solutions, %d elements\n", r, nproblems, nsolutions, nelements, nproblems0, nsolutions0, nelements0);
+	  exit(1);
+	}
+      solver_free(solv);
+    }
+
+  printf("%d solvables, %d installed, %d packages to install\n", pool->nsolvables, installed->nsolvables, job.count / 2);
+  printf("solve:     %u ms, %d problems\n", solvems, nproblems0);
+  printf("solutions: %u ms, %d solutions with %d elements", solms, nsolutions0, nelements0);
+  if (nproblems0)
+    printf(", %.1f ms per problem", (double)solms / nproblems0);
+  printf("\n");
+  queue_free(&decisions);
+  queue_free(&recommendations);
+  queue_free(&job);
+  pool_free(pool);
+  return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * whatprovidesbench
+ *
+ * times pool_createwhatprovides() on a synthetic pool and checks
+ * that the threaded creation gives the same data as a single thread.
+ * Then a repo is added, disabled, enabled, emptied and freed. After
+ * each step the updated data must have the same provider lists as a
+ * full creation and must count all lists it no longer uses as garbage.
+ *
+ * Usage:
+ *   whatprovidesbench [-n <solvables>] [-t <threads>] [-r <rounds>]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* packages in two versions, with library, virtual and file provides */
+static void
+fillrepo(Pool *pool, Repo *repo, int nsolvables)
+{
+  Id archs[2], evrs[2], p, name;
+  Solvable *s;
+  char buf[64];
+  int i, j, npkgs = (nsolvables + 1) / 2;
+
+  archs[0] = str2id(pool, "i686", 1);
+  archs[1] = str2id(pool, "noarch", 1);
+  evrs[0] = str2id(pool, "1.0-1", 1);
+  evrs[1] = str2id(pool, "1.1-1", 1);
+  for (i = 0; i < nsolvables; i++)
+    {
+      p = repo_add_solvable(repo);
+      s = pool->solvables + p;
+      sprintf(buf, "pkg%d", i / 2);
+      name = str2id(pool, buf, 1);
+      s->name = name;
+      s->evr = evrs[i & 1];
+      s->arch = archs[bench_rnd(4) == 0];
+      s->vendor = 0;
+      s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, name, s->evr, REL_EQ, 1), 0);
+      if (bench_rnd(3) == 0)
+	s->provides = repo_addid_dep(repo, s->provides, name, 0);
+      for (j = bench_rnd(4); j > 0; j--)
+	{
+	  sprintf(buf, "lib%u.so.1", bench_rnd(npkgs / 4 + 1));
+	  s->provides = repo_addid_dep(repo, s->provides, str2id(pool, buf, 1), 0);
+	}
+      if (bench_rnd(8) == 0)
+	{
+	  sprintf(buf, "cap%u", bench_rnd(200));
+	  s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, str2id(pool, buf, 1), evrs[0], REL_EQ, 1), 0);
+	}
+      sprintf(buf, "/usr/bin/pkg%d", i / 2);
+      s->provides = repo_addid_dep(repo, s->provides, str2id(pool, buf, 1), 0);
+    }
+}
+
+/* time a full creation, returns the time in ms */
+static unsigned int
+create(Pool *pool, int threads)
+{
+  unsigned int now;
+
+  pool->whatprovidesthreads = threads;
+  pool_freewhatprovides(pool);
+  now = sat_timems(0);
+  pool_createwhatprovides(pool);
+  return sat_timems(now);
+}
+
+/* the size of the data that no list refers to */
+static Offset
+unreferenced(Pool *pool)
+{
+  Map m;
+  Offset off, used = 0;
+  Id id, *pp;
+
+  map_init(&m, pool->whatprovidesdataoff);
+  for (id = 1; id < pool->ss.nstrings + pool->nrels; id++)
+    {
+      off = id < pool->ss.nstrings ? pool->whatprovides[id] : pool->whatprovides_rel[id - pool->ss.nstrings];
+      if (off <= 1 || MAPTST(&m, off))
+	continue;
+      MAPSET(&m, off);
+      for (pp = pool->whatprovidesdata + off; *pp; pp++)
+	used++;
+      used++;
+    }
+  map_free(&m);
+  return pool->whatprovidesdataoff - used;
+}
+
+/* the providers of all names and relations */
+static void
+getlists(Pool *pool, Queue *q)
+{
+  Id id, *pp;
+
+  queue_empty(q);
+  for (id = 1; id < pool->ss.nstrings; id++)
+    {
+      for (pp = pool_whatprovides_ptr(pool, id); *pp; pp++)
+	queue_push(q, *pp);
+      queue_push(q, 0);
+    }
+  for (id = 1; id < pool->nrels; id++)
+    {
+      for (pp = pool_whatprovides_ptr(pool, MAKERELDEP(id)); *pp; pp++)
+	queue_push(q, *pp);
+      queue_push(q, 0);
+    }
+}
+
+/* update the data after a change of the pool and compare it with
+ * a full creation. base is the unreferenced size before the change.
+ * returns 0 if they differ */
+static int
+checkupdate(Pool *pool, const char *step, Offset base, Queue *q1, Queue *q2)
+{
+  Offset garbage, dead;
+
+  pool_createwhatprovides(pool);
+  garbage = unreferenced(pool) - base;
+  dead = pool->whatprovidesdead;
+  getlists(pool, q1);
+  pool_freewhatprovides(pool);
+  pool_createwhatprovides(pool);
+  getlists(pool, q2);
+  if (q1->count != q2->count || memcmp(q1->elements, q2->elements, q1->count * sizeof(Id)) != 0)
+    {
+      fprintf(stderr, "%s: the updated data differs from a full creation\n", step);
+      return 0;
+    }
+  if (garbage != dead)
+    {
+      fprintf(stderr, "%s: %d unused entries, but %d counted as garbage\n", step, garbage, dead);
+      return 0;
+    }
+  printf("%-8s %d entries of garbage\n", step, dead);
+  return 1;
+}
+
+int
+main(int argc, char **argv)
+{
+  Pool *pool;
+  Repo *repo, *extra;
+  Queue q1, q2;
+  Offset *wp;
+  Id *wpdata;
+  Offset wpoff;
+  int c, r, t, ok, nsolvables = 100000, threads = 4, rounds = 3;
+  unsigned int ms, best;
+
+  while ((c = getopt(argc, argv, "n:t:r:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 't':
+	  threads = atoi(optarg);
+	  break;
+	case 'r':
+	  rounds = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: whatprovidesbench [-n <solvables>] [-t <threads>] [-r <rounds>]\n");
+	  exit(1);
+	}
+    }
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  repo = repo_create(pool, "synthetic");
+  fillrepo(pool, repo, nsolvables);
+  printf("%d solvables, %d ids, %d relations\n", pool->nsolvables, pool->ss.nstrings, pool->nrels);
+
+  create(pool, 1);
+  wp = sat_malloc2(pool->ss.nstrings, sizeof(Offset));
+  memcpy(wp, pool->whatprovides, pool->ss.nstrings * sizeof(Offset));
+  wpoff = pool->whatprovidesdataoff;
+  wpdata = sat_malloc2(wpoff, sizeof(Id));
+  memcpy(wpdata, pool->whatprovidesdata, wpoff * sizeof(Id));
+
+  for (t = 1; t <= threads; t++)
+    {
+      best = 0;
+      for (r = 0; r < rounds; r++)
+	{
+	  ms = create(pool, t);
+	  if (!r || ms < best)
+	    best = ms;
+	}
+      if (pool->whatprovidesdataoff != wpoff || memcmp(pool->whatprovides, wp, pool->ss.nstrings * sizeof(Offset)) || memcmp(pool->whatprovidesdata, wpdata, wpoff * sizeof(Id)))
+	{
+	  fprintf(stderr, "%d threads: whatprovides data differs\n", t);
+	  exit(1);
+	}
+      printf("%d threads: %u ms\n", t, best);
+    }
+  sat_free(wp);
+  sat_free(wpdata);
+
+  /* the relation lists are created by getlists(), so that there
+   * are some to drop */
+  queue_init(&q1);
+  queue_init(&q2);
+  create(pool, 1);
+  getlists(pool, &q1);
+  ok = 1;
+  extra = repo_create(pool, "extra");
+  wpoff = unreferenced(pool);
+  fillrepo(pool, extra, nsolvables / 20);
+  ok &= checkupdate(pool, "add", wpoff, &q1, &q2);
+  wpoff = unreferenced(pool);
+  extra->disabled = 1;
+  ok &= checkupdate(pool, "disable", wpoff, &q1, &q2);
+  wpoff = unreferenced(pool);
+  extra->disabled = 0;
+  ok &= checkupdate(pool, "enable", wpoff, &q1, &q2);
+  wpoff = unreferenced(pool);
+  repo_empty(extra, 0);
+  ok &= checkupdate(pool, "empty", wpoff, &q1, &q2);
+  fillrepo(pool, extra, nsolvables / 20);
+  create(pool, 1);
+  getlists(pool, &q1);
+  wpoff = unreferenced(pool);
+  repo_free(extra, 0);
+  ok &= checkupdate(pool, "free", wpoff, &q1, &q2);
+  queue_free(&q1);
+  queue_free(&q2);
+  pool_free(pool);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2011, Novell Inc.
+ *
+ * This program is licensed under the BSD license, read LICENSE.BSD
+ * for further information
+ */
+
+/*
+ * whatrequiresbench
+ *
+ * times pool_createwhatrequires() against pool_createwhatprovides()
+ * and against solving some install jobs. The first solve that looks
+ * for supplementing packages, or pool_freeze(), builds the index, so
+ * its cost is paid once per pool change. The requires and recommends
+ * lists are checked against the providers of the dependencies.
+ *
+ * Usage:
+ *   whatrequiresbench [-n <solvables>] [-j <jobs>] [-r <rounds>]
+ *   whatrequiresbench [-j <jobs>] [-r <rounds>] <installed solv> <solv files...>
+ *
+ * Without solv files a synthetic pool is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+
+#include "pool.h"
+#include "poolarch.h"
+#include "repo.h"
+#include "solver.h"
+#include "util.h"
+#include "benchutil.h"
+
+/* packages require, recommend and supplement other packages */
+static void
+adddeps(Pool *pool, Repo *repo, Solvable *s, int j, int npkgs, const Id *evrs)
+{
+  Id dep;
+  char buf[64];
+
+  sprintf(buf, "lib%u.so.1", (j / 2) % (npkgs / 8 + 1));
+  s->provides = repo_addid_dep(repo, s->provides, str2id(pool, buf, 1), 0);
+  if (j < 8)
+    return;
+  sprintf(buf, "lib%u.so.1", bench_rnd(j / 2) % (npkgs / 8 + 1));
+  s->requires = repo_addid_dep(repo, s->requires, str2id(pool, buf, 1), 0);
+  sprintf(buf, "pkg%d", bench_rnd(j / 2));
+  dep = rel2id(pool, str2id(pool, buf, 1), evrs[0], REL_GT | REL_EQ, 1);
+  s->requires = repo_addid_dep(repo, s->requires, dep, 0);
+  if (bench_rnd(4) == 0)
+    {
+      sprintf(buf, "pkg%d", bench_rnd(j / 2));
+      s->recommends = repo_addid_dep(repo, s->recommends, str2id(pool, buf, 1), 0);
+    }
+  if (bench_rnd(20) == 0)
+    {
+      sprintf(buf, "pkg%d", bench_rnd(j / 2));
+      s->supplements = repo_addid_dep(repo, s->supplements, str2id(pool, buf, 1), 0);
+    }
+}
+
+static int
+idcmp(const void *ap, const void *bp)
+{
+  return *(const Id *)ap - *(const Id *)bp;
+}
+
+/*
+ * check the lists of one dependency type: every requirer of one of
+ * the providers of a dependency must be on the provider's list, and
+ * the lists must hold nothing else. returns the number of entries,
+ * -1 if the index is wrong.
+ */
+static int
+checkindex(Pool *pool, Id keyname)
+{
+  Id p, pp, i, dep, *dp, *wp, *lastseen;
+  Offset off;
+  Solvable *s;
+  int n, nentries = 0, npairs = 0;
+
+  for (p = 1; p < pool->nsolvables; p++)
+    {
+      wp = pool_whatrequires_ptr(pool, p, keyname);
+      for (n = 0; wp[n]; n++)
+	if (n && wp[n - 1] >= wp[n])
+	  return -1;	/* the lists are sorted */
+      nentries += n;
+    }
+  lastseen = sat_calloc(pool->nsolvables, sizeof(Id));
+  for (i = 2; i < pool->nsolvables; i++)
+    {
+      s = pool->solvables + i;
+      off = keyname == SOLVABLE_REQUIRES ? s->requires : s->recommends;
+      if (!s->repo || !off)
+	continue;
+      for (dp = s->repo->idarraydata + off; (dep = *dp++) != 0; )
+	{
+	  if (dep == SOLVABLE_PREREQMARKER)
+	    continue;
+	  FOR_PROVIDES(p, pp, dep)
+	    {
+	      if (lastseen[p] == i)
+		continue;
+	      lastseen[p] = i;
+	      npairs++;
+	      wp = pool_whatrequires_ptr(pool, p, keyname);
+	      for (n = 0; wp[n]; n++)
+		;
+	      if (!bsearch(&i, wp, n, sizeof(Id), idcmp))
+		{
+		  sat_free(lastseen);
+		  return -1;
+		}
+	    }
+	}
+    }
+  sat_free(lastseen);
+  return npairs == nentries ? nentries : -1;
+}
+
+int
+main(int argc, char **argv)
+{
+  static const Id keynames[] = { SOLVABLE_REQUIRES, SOLVABLE_RECOMMENDS };
+  Pool *pool;
+  Repo *installed, *repo;
+  Solver *solv;
+  Queue *jobs;
+  int c, i, r, n, nentries;
+  int nsolvables = 20000, njobs = 5, rounds = 3;
+  unsigned int now, wpms, ms, best, solvems;
+
+  while ((c = getopt(argc, argv, "n:j:r:")) >= 0)
+    {
+      switch (c)
+	{
+	case 'n':
+	  nsolvables = atoi(optarg);
+	  break;
+	case 'j':
+	  njobs = atoi(optarg);
+	  break;
+	case 'r':
+	  rounds = atoi(optarg);
+	  break;
+	default:
+	  fprintf(stderr, "Usage: whatrequiresbench [-n <solvables>] [-j <jobs>] [-r <rounds>] [<installed solv> <solv files...>]\n");
+	  exit(1);
+	}
+    }
+  if (nsolvables < 16)
+    nsolvables = 16;
+  if (njobs <= 0)
+    njobs = 1;
+  if (rounds <= 0)
+    rounds = 1;
+
+  pool = pool_create();
+  pool_setarch(pool, "i686");
+  if (optind < argc)
+    installed = bench_readrepos(pool, argc - optind, argv + optind);
+  else
+    {
+      installed = repo_create(pool, "installed");
+      repo = repo_create(pool, "available");
+      bench_fillrepos(pool, installed, repo, nsolvables, adddeps);
+    }
+  pool_set_installed(pool, installed);
+  pool_addfileprovides(pool);
+  now = sat_timems(0);
+  pool_createwhatprovides(pool);
+  wpms = sat_timems(now);
+
+  best = 0;
+  for (r = 0; r < rounds; r++)
+    {
+      pool_freewhatrequires(pool);
+      now = sat_timems(0);
+      pool_createwhatrequires(pool);
+      ms = sat_timems(now);
+      if (!r || ms < best)
+	best = ms;
+    }
+  nentries = 0;
+  for (i = 0; i < 2; i++)
+    {
+      if ((n = checkindex(pool, keynames[i])) < 0)
+	{
+	  fprintf(stderr, "%s: the index differs from the providers\n", id2str(pool, keynames[i]));
+	  exit(1);
+	}
+      nentries += n;
+    }
+
+  /* the index is kept, so this is the solve time without it */
+  jobs = bench_makejobs(pool, njobs, 0);
+  now = sat_timems(0);
+  for (i = 0; i < njobs; i++)
+    {
+      solv = solver_create(pool);
+      solver_solve(solv, jobs + i);
+      solver_free(solv);
+    }
+  solvems = sat_timems(now);
+
+  printf("%d solvables, %d installed\n", pool->nsolvables, installed->nsolvables);
+  printf("createwhatprovides: %u ms\n", wpms);
+  printf("createwhatrequires: %u ms, %d requires and recommends entries\n", best, nentries);
+  printf("solve:              %u ms per job (%d jobs)\n", solvems / njobs, njobs);
+  bench_freejobs(jobs, njobs);
+  pool_free(pool);
+  return 0;
+}
@@ -40,6 +40,8 @@
 
 static int verbose = 0;
 static int redcarpet = 0;
+static int reuse = 0;
+static int grow = 0;
 
 static const char *Current;
 
@@ -1442,6 +1444,114 @@ rc_printdownloadsize(Solver *solv)
   printf("download size: %d\n\n", d);
 }
 
+/*
+ * create a solver with the settings of the test case
+ */
+
+static Solver *
+create_solver(Parsedata *pd)
+{
+  Solver *solv = solver_create(pd->pool);
+  solv->fixsystem = pd->fixsystem;
+  pd->pool->allowselfconflicts = 1;	/* XXX: should fix test cases instead */
+  solv->updatesystem = pd->updatesystem;
+  solv->allowdowngrade = pd->allowdowngrade;
+  solv->allowuninstall = pd->allowuninstall;
+  solv->allowarchchange = pd->allowarchchange;
+  solv->allowvendorchange = pd->allowvendorchange;
+  solv->dosplitprovides = pd->dosplitprovides;
+  solv->dontinstallrecommended = pd->dontinstallrecommended;
+  solv->ignorealreadyrecommended = pd->ignorealreadyrecommended;
+  solv->distupgrade = pd->distupgrade;
+  solv->distupgrade_removeunsupported = pd->distupgrade_removeunsupported;
+  solv->noupdateprovide = 0;
+  return solv;
+}
+
+
+/*
+ * --reuse: weakly install every available package, so that the
+ * solver has rpm rules for all of them before the trial is solved
+ */
+
+static void
+solve_warmup(Parsedata *pd, Solver *solv)
+{
+  Pool *pool = pd->pool;
+  Queue job;
+  Id p;
+
+  queue_init(&job);
+  for (p = 2; p < pool->nsolvables; p++)
+    if (pool->solvables[p].repo && pool->solvables[p].repo != pd->system)
+      queue_push2(&job, SOLVER_INSTALL_SOLVABLE | SOLVER_WEAK, p);
+  solver_solve(solv, &job);
+  queue_free(&job);
+}
+
+
+static int
+same_queue(Queue *q1, Queue *q2)
+{
+  int i;
+
+  if (q1->count != q2->count)
+    return 0;
+  for (i = 0; i < q1->count; i++)
+    if (q1->elements[i] != q2->elements[i])
+      return 0;
+  return 1;
+}
+
+/*
+ * --grow: add a repo of unrelated packages to the pool, so that the
+ * solver has to cope with more solvables than it was created for
+ */
+
+static void
+grow_pool(Parsedata *pd)
+{
+  Pool *pool = pd->pool;
+  Repo *repo = repo_create(pool, "grow");
+  Id p, evr = str2id(pool, "1.0-1", 1);
+  Solvable *s;
+  char buf[64];
+  int i;
+
+  for (i = 0; i < 2000; i++)
+    {
+      p = repo_add_solvable(repo);
+      s = pool->solvables + p;
+      sprintf(buf, "deptestomatic-grow-%d", i);
+      s->name = str2id(pool, buf, 1);
+      s->evr = evr;
+      s->arch = ARCH_NOARCH;
+      s->provides = repo_addid_dep(repo, s->provides, rel2id(pool, s->name, evr, REL_EQ, 1), 0);
+    }
+  pool_createwhatprovides(pool);
+}
+
+
+/*
+ * --reuse, --grow: the trial must give the same result as with a
+ * fresh solver
+ */
+
+static void
+check_reuse(Parsedata *pd, Solver *solv)
+{
+  Solver *fsolv = create_solver(pd);
+
+  solver_solve(fsolv, &pd->trials);
+  if (!same_queue(&fsolv->decisionq, &solv->decisionq) || !same_queue(&fsolv->problems, &solv->problems))
+    {
+      fprintf(stderr, "%s: the reused solver gives a different result\n", Current);
+      exit(2);
+    }
+  solver_free(fsolv);
+}
+
+
 /*
  * XML callback
  * </name>
@@ -1484,23 +1594,25 @@ endElement( void *userData, const char *name )
       if (redcarpet)
         pool->promoteepoch = 1;
 
-      Solver *solv = solver_create(pd->pool);
-      solv->fixsystem = pd->fixsystem;
-      pd->pool->allowselfconflicts = 1;	/* XXX: should fix test cases instead */
-      solv->updatesystem = pd->updatesystem;
-      solv->allowdowngrade = pd->allowdowngrade;
-      solv->allowuninstall = pd->allowuninstall;
-      solv->allowarchchange = pd->allowarchchange;
-      solv->allowvendorchange = pd->allowvendorchange;
-      solv->dosplitprovides = pd->dosplitprovides;
-      solv->dontinstallrecommended = pd->dontinstallrecommended;
-      solv->ignorealreadyrecommended = pd->ignorealreadyrecommended;
-      solv->distupgrade = pd->distupgrade;
-      solv->distupgrade_removeunsupported = pd->distupgrade_removeunsupported;
-      solv->noupdateprovide = 0;
+      Solver *solv = create_solver(pd);
+      if (reuse)
+	{
+	  // solve an unrelated job first and keep its rpm rules
+	  solv->reuserpmrules = 1;
+	  solve_warmup(pd, solv);
+	}
+      if (grow)
+	{
+	  // solve the trial on the small pool, then on the grown one
+	  solv->reuserpmrules = 1;
+	  solver_solve( solv, &pd->trials );
+	  grow_pool(pd);
+	}
 
       // Solve !
       solver_solve( solv, &pd->trials );
+      if (reuse || grow)
+	check_reuse(pd, solv);
       // print result
       if (solv->problems.count)
 	solver_printallsolutions(solv);
@@ -1670,7 +1782,7 @@ rc_printdecisions(Solver *solv, Queue *job)
 static void
 usage( void )
 {
-  fprintf( stderr, "Usage: deptestomatic [-v] <test-xml>\n" );
+  fprintf( stderr, "Usage: deptestomatic [--redcarpet] [--reuse] [--grow] [-v] <test-xml>\n" );
   exit( 1 );
 }
 
@@ -1734,6 +1846,18 @@ main( int argc, char **argv )
       ++argp;
     }
 
+  if (argp < argc && !strcmp( argv[argp], "--reuse" ))
+    {
+      reuse = 1;
+      ++argp;
+    }
+
+  if (argp < argc && !strcmp( argv[argp], "--grow" ))
+    {
+      grow = 1;
+      ++argp;
+    }
+
   while (argp < argc && !strcmp( argv[argp], "-v" ))
     {
       verbose++;
@@ -11,6 +11,12 @@
 #  runtest.rb [-r] <dir>
 #     run all test cases (*test.xml) below a specific directory
 #     if -r is given, recursively descend to sub-directories
+#  runtest.rb --reuse ...
+#     solve another job on the same solver first and check that
+#     the kept rpm rules do not change the result
+#  runtest.rb --grow ...
+#     add packages to the pool after solving and check that solving
+#     again with the same solver gives the result of a fresh one
 #
 
 require 'test/unit'
@@ -19,6 +25,8 @@ require 'getoptlong'
 
 $verbose = false
 $redcarpet = false
+$reuse = false
+$grow = false
 
 $tests = Array.new
 $builddir= File.join( Dir.getwd, "../..")
@@ -238,6 +246,8 @@ class Tester < Test::Unit::TestCase
       dir = File.dirname(test)
       args = ""
       args = "--redcarpet" if $redcarpet
+      args += " --reuse" if $reuse
+      args += " --grow" if $grow
       if ( system( "#{$deptestomatic} #{args} #{dir}/#{basename}.xml > #{dir}/#{basename}.result" ) )
         sname = File.join( dir, "#{basename}.solution" )
         rname = File.join( dir, "#{basename}.result" )
@@ -271,6 +281,12 @@ class Tester < Test::Unit::TestCase
 	end
 #        assert(  )
 #      puts "(cd #{File.dirname(test)}; #{$deptestomatic} #{basename}.xml > #{basename}.result)" 
+      elsif $reuse && $?.exitstatus == 2
+	puts "#{test} differs with reused rpm rules"
+	ufailed += 1
+      elsif $grow && $?.exitstatus == 2
+	puts "#{test} differs after the pool grew"
+	ufailed += 1
       else
 	puts "#{test} is incomplete"
       end
@@ -472,6 +488,8 @@ puts "Running in #{Dir.getwd}"
 opts = GetoptLong.new(
       [ '--help', '-h', GetoptLong::NO_ARGUMENT ],
       [ '--redcarpet', GetoptLong::NO_ARGUMENT ],
+      [ '--reuse', GetoptLong::NO_ARGUMENT ],
+      [ '--grow', GetoptLong::NO_ARGUMENT ],
       [ '-r', GetoptLong::NO_ARGUMENT ],
       [ '-v', GetoptLong::NO_ARGUMENT ],
       [ '-s', GetoptLong::OPTIONAL_ARGUMENT ],
@@ -486,6 +504,10 @@ opts.each do |opt, arg|
           usage
         when '--redcarpet'
           $redcarpet = true
+        when '--reuse'
+          $reuse = true
+        when '--grow'
+          $grow = true
         when '-r'
           recurse = true
         when '-v'
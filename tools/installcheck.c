@@ -193,8 +193,11 @@ main(int argc, char **argv)
       archlock = pool_queuetowhatprovides(pool, &archlocks);
     }
   /* prune cand by doing weak installs */
+  solv = 0;
   while (cand.count)
     {
+      if (solv)
+	solver_free(solv);
       solv = solver_create(pool);
       queue_empty(&job);
       for (i = 0; i < cand.count; i++)
@@ -237,8 +240,15 @@ main(int argc, char **argv)
       if (i == j)
 	break;
     }
+  if (!cand.count && solv)
+    {
+      solver_free(solv);
+      solv = 0;
+    }
 
-  /* now check every candidate */
+  /* now check every candidate. The rules of the last solver run
+   * contain all remaining candidates, so we can ask the solver
+   * directly instead of solving a new job for each one */
   for (i = 0; i < cand.count; i++)
     {
       Solvable *s;
@@ -267,120 +277,92 @@ main(int argc, char **argv)
             continue;
         }
       s = pool->solvables + p;
-      solv = solver_create(pool);
-      queue_empty(&job);
-      queue_push(&job, SOLVER_INSTALL|SOLVER_SOLVABLE);
-      queue_push(&job, p);
-      if (rpmrel)
-	{
-	  queue_push(&job, SOLVER_INSTALL|SOLVER_SOLVABLE_NAME);
-	  queue_push(&job, rpmrel);
-	}
-      if (archlock)
+      if (!solver_installable(solv, p, &rids))
 	{
-	  queue_push(&job, SOLVER_LOCK|SOLVER_SOLVABLE_ONE_OF);
-	  queue_push(&job, archlock);
-	}
-      solv->dontinstallrecommended = 1;
-      solver_solve(solv, &job);
-      if (solv->problems.count)
-	{
-	  Id problem = 0;
 	  Solvable *s2;
 
 	  status = 1;
 	  printf("can't install %s:\n", solvable2str(pool, s));
-	  while ((problem = solver_next_problem(solv, problem)) != 0)
+	  for (j = 0; j < rids.count; j++)
 	    {
-	      solver_findallproblemrules(solv, problem, &rids);
-	      for (j = 0; j < rids.count; j++)
-		{
-		  Id probr = rids.elements[j];
-		  int k;
-		  Queue rinfo;
-		  queue_init(&rinfo);
+	      Id probr = rids.elements[j];
+	      int k;
+	      Queue rinfo;
+	      queue_init(&rinfo);
 
-		  solver_allruleinfos(solv, probr, &rinfo);
-		  for (k = 0; k < rinfo.count; k += 4)
+	      solver_allruleinfos(solv, probr, &rinfo);
+	      for (k = 0; k < rinfo.count; k += 4)
+		{
+		  Id dep, source, target;
+		  source = rinfo.elements[k + 1];
+		  target = rinfo.elements[k + 2];
+		  dep = rinfo.elements[k + 3];
+		  switch (rinfo.elements[k])
 		    {
-		      Id dep, source, target;
-		      source = rinfo.elements[k + 1];
-		      target = rinfo.elements[k + 2];
-		      dep = rinfo.elements[k + 3];
-		      switch (rinfo.elements[k])
+		    case SOLVER_PROBLEM_DISTUPGRADE_RULE:
+		      break;
+		    case SOLVER_PROBLEM_INFARCH_RULE:
+		      s = pool_id2solvable(pool, source);
+		      printf("  %s has inferior architecture\n", solvable2str(pool, s));
+		      break;
+		    case SOLVER_PROBLEM_UPDATE_RULE:
+		      break;
+		    case SOLVER_PROBLEM_JOB_RULE:
+		      break;
+		    case SOLVER_PROBLEM_RPM_RULE:
+		      printf("  some dependency problem\n");
+		      break;
+		    case SOLVER_PROBLEM_JOB_NOTHING_PROVIDES_DEP:
+		      printf("  nothing provides requested %s\n", dep2str(pool, dep));
+		      break;
+		    case SOLVER_PROBLEM_NOT_INSTALLABLE:
+		      s = pool_id2solvable(pool, source);
+		      printf("  package %s is not installable\n", solvable2str(pool, s));
+		      break;
+		    case SOLVER_PROBLEM_NOTHING_PROVIDES_DEP:
+		      s = pool_id2solvable(pool, source);
+		      printf("  nothing provides %s needed by %s\n", dep2str(pool, dep), solvable2str(pool, s));
+		      if (ISRELDEP(dep))
 			{
-			case SOLVER_PROBLEM_DISTUPGRADE_RULE:
-			  break;
-			case SOLVER_PROBLEM_INFARCH_RULE:
-			  s = pool_id2solvable(pool, source);
-			  printf("  %s has inferior architecture\n", solvable2str(pool, s));
-			  break;
-			case SOLVER_PROBLEM_UPDATE_RULE:
-			  break;
-			case SOLVER_PROBLEM_JOB_RULE:
-			  break;
-			case SOLVER_PROBLEM_RPM_RULE:
-			  printf("  some dependency problem\n");
-			  break;
-			case SOLVER_PROBLEM_JOB_NOTHING_PROVIDES_DEP:
-			  printf("  nothing provides requested %s\n", dep2str(pool, dep));
-			  break;
-			case SOLVER_PROBLEM_NOT_INSTALLABLE:
-			  s = pool_id2solvable(pool, source);
-			  printf("  package %s is not installable\n", solvable2str(pool, s));
-			  break;
-			case SOLVER_PROBLEM_NOTHING_PROVIDES_DEP:
-			  s = pool_id2solvable(pool, source);
-			  printf("  nothing provides %s needed by %s\n", dep2str(pool, dep), solvable2str(pool, s));
-			  if (ISRELDEP(dep))
+			  Reldep *rd = GETRELDEP(pool, dep);
+			  if (!ISRELDEP(rd->name))
 			    {
-			      Reldep *rd = GETRELDEP(pool, dep);
-			      if (!ISRELDEP(rd->name))
-				{
-				  Id rp, rpp;
-				  FOR_PROVIDES(rp, rpp, rd->name)
-				    printf("    (we have %s)\n", solvable2str(pool, pool->solvables + rp));
-				}
+			      Id rp, rpp;
+			      FOR_PROVIDES(rp, rpp, rd->name)
+				printf("    (we have %s)\n", solvable2str(pool, pool->solvables + rp));
 			    }
-			  break;
-			case SOLVER_PROBLEM_SAME_NAME:
-			  s = pool_id2solvable(pool, source);
-			  s2 = pool_id2solvable(pool, target);
-			  printf("  cannot install both %s and %s\n", solvable2str(pool, s), solvable2str(pool, s2));
-			  break;
-			case SOLVER_PROBLEM_PACKAGE_CONFLICT:
-			  s = pool_id2solvable(pool, source);
-			  s2 = pool_id2solvable(pool, target);
-			  printf("  package %s conflicts with %s provided by %s\n", solvable2str(pool, s), dep2str(pool, dep), solvable2str(pool, s2));
-			  break;
-			case SOLVER_PROBLEM_PACKAGE_OBSOLETES:
-			  s = pool_id2solvable(pool, source);
-			  s2 = pool_id2solvable(pool, target);
-			  printf("  package %s obsoletes %s provided by %s\n", solvable2str(pool, s), dep2str(pool, dep), solvable2str(pool, s2));
-			  break;
-			case SOLVER_PROBLEM_DEP_PROVIDERS_NOT_INSTALLABLE:
-			  s = pool_id2solvable(pool, source);
-			  printf("  package %s requires %s, but none of the providers can be installed\n", solvable2str(pool, s), dep2str(pool, dep));
-			  break;
-			case SOLVER_PROBLEM_SELF_CONFLICT:
-			  s = pool_id2solvable(pool, source);
-			  printf("  package %s conflicts with %s provided by itself\n", solvable2str(pool, s), dep2str(pool, dep));
-			  break;
 			}
+		      break;
+		    case SOLVER_PROBLEM_SAME_NAME:
+		      s = pool_id2solvable(pool, source);
+		      s2 = pool_id2solvable(pool, target);
+		      printf("  cannot install both %s and %s\n", solvable2str(pool, s), solvable2str(pool, s2));
+		      break;
+		    case SOLVER_PROBLEM_PACKAGE_CONFLICT:
+		      s = pool_id2solvable(pool, source);
+		      s2 = pool_id2solvable(pool, target);
+		      printf("  package %s conflicts with %s provided by %s\n", solvable2str(pool, s), dep2str(pool, dep), solvable2str(pool, s2));
+		      break;
+		    case SOLVER_PROBLEM_PACKAGE_OBSOLETES:
+		      s = pool_id2solvable(pool, source);
+		      s2 = pool_id2solvable(pool, target);
+		      printf("  package %s obsoletes %s provided by %s\n", solvable2str(pool, s), dep2str(pool, dep), solvable2str(pool, s2));
+		      break;
+		    case SOLVER_PROBLEM_DEP_PROVIDERS_NOT_INSTALLABLE:
+		      s = pool_id2solvable(pool, source);
+		      printf("  package %s requires %s, but none of the providers can be installed\n", solvable2str(pool, s), dep2str(pool, dep));
+		      break;
+		    case SOLVER_PROBLEM_SELF_CONFLICT:
+		      s = pool_id2solvable(pool, source);
+		      printf("  package %s conflicts with %s provided by itself\n", solvable2str(pool, s), dep2str(pool, dep));
+		      break;
 		    }
 		}
+	      queue_free(&rinfo);
 	    }
 	}
-#if 0
-      else
-	{
-	  if (!strcmp(id2str(pool, s->name), "libusb-compat-devel"))
-	    {
-	      solver_printdecisions(solv);
-	    }
-	}
-#endif
-      solver_free(solv);
     }
+  if (solv)
+    solver_free(solv);
   exit(status);
 }
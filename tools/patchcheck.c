@@ -259,7 +259,7 @@ test_all_old_patches_included(context_t *c, Id pid)
 void
 test_all_packages_installable(context_t *c, Id pid)
 {
-  Solver *solv;
+  Solver *solv, *osolv;
   Queue job;
   Id p, pp;
   Id con, *conp;
@@ -272,6 +272,12 @@ test_all_packages_installable(context_t *c, Id pid)
   now = sat_timems(0);
   solver_runs = 0;
 
+  /* the original packages are always installed into the same system,
+   * so the solver and its rpm rules can be used for all of them */
+  osolv = solver_create(pool);
+  osolv->dontinstallrecommended = 0;
+  osolv->reuserpmrules = 1;
+
   conp = s->repo->idarraydata + s->conflicts;
   while ((con = *conp++) != 0)
     {
@@ -287,18 +293,15 @@ test_all_packages_installable(context_t *c, Id pid)
           queue_push(&job, SOLVER_INSTALL|SOLVER_SOLVABLE_PROVIDES|SOLVER_WEAK);
           queue_push(&job, str2id(pool, "aaa_base", 1));
 
-          solv = solver_create(pool);
-          solv->dontinstallrecommended = 0;
           ++solver_runs;
-          solver_solve(solv, &job);
-          if (solv->problems.count)
+          solver_solve(osolv, &job);
+          if (osolv->problems.count)
             {
               c->status = 1;
               printf("error installing original package\n");
-              showproblems(solv, s, 0, 0);
+              showproblems(osolv, s, 0, 0);
             }
-          toinst(solv, c->repo, c->instrepo);
-          solver_free(solv);
+          toinst(osolv, c->repo, c->instrepo);
 
 #if 0
           dump_instrepo(instrepo, pool);
@@ -330,6 +333,8 @@ test_all_packages_installable(context_t *c, Id pid)
           solver_free(solv);
         }
     }
+  solver_free(osolv);
+  queue_free(&job);
 
   if (PERF_DEBUGGING)
     printf("  test_all_packages_installable took %d ms in %d runs\n", sat_timems(now), solver_runs);